@@ -0,0 +1,747 @@
+
+#include <simplejson.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SIMPLEJSON_BENCH_PERF
+#endif
+
+/**
+ * simplejson_bench: throughput, latency and allocation counts for the
+ * core JSON operations over deterministic synthetic corpora and any JSON
+ * files given on the command line. Results are printed as one JSON
+ * document on stdout so runs can be stored and compared.
+ *
+ *   simplejson_bench [--size BYTES] [--min-time SECONDS]
+ *                    [--filter TEXT] [--counters] [FILE...]
+ *
+ * --counters also reads hardware counters around every operation through
+ * perf_event_open on Linux. Counters the kernel or container refuses are
+ * left out of the report, and the reason is printed on stderr.
+ */
+
+namespace fs = std::filesystem;
+
+using json::JSON;
+
+namespace {
+
+// heap allocations made by the whole process, see operator new below
+std::atomic<size_t> allocations{ 0 };
+
+/**
+ * Default memory resource forwarding to the counted operator new below;
+ * the library's own new_delete_resource allocates out of reach of it
+ */
+struct Counted_Resource : std::pmr::memory_resource
+{
+    void* do_allocate(size_t bytes, size_t align) override
+    {
+        return ::operator new(bytes, std::align_val_t(align));
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override
+    {
+        ::operator delete(p, bytes, std::align_val_t(align));
+    }
+    bool do_is_equal(std::pmr::memory_resource const& other) const
+        noexcept override
+    {
+        return this == &other;
+    }
+};
+
+// keeps benchmarked results observable so they are not optimized away
+volatile size_t sink = 0;
+
+// xorshift64*, seeded the same on every run and platform
+struct Random
+{
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+
+    inline uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545f4914f6cdd1dULL;
+    }
+    inline size_t below(size_t bound)
+    {
+        return static_cast<size_t>(next() % bound);
+    }
+};
+
+struct Corpus
+{
+    std::string name;
+    std::string text;
+    // one document per line instead of a single document
+    bool lines = false;
+};
+
+struct Result
+{
+    std::string corpus;
+    std::string operation;
+    size_t bytes;
+    size_t iterations;
+    double ns_per_op;
+    double mb_per_s;
+    double allocations_per_op;
+    // values built or visited per op, for the per-node counter figures
+    size_t nodes = 0;
+    // hardware counter name and its count per op
+    std::vector<std::pair<std::string, double>> counters{};
+};
+
+/**
+ * Hardware counters opened one by one rather than as a group, so that
+ * a counter the CPU lacks does not take the others down with it.
+ * Counts are scaled by the time each counter was actually scheduled
+ * when the kernel multiplexes them.
+ */
+class Counters
+{
+  public:
+    Counters() = default;
+    Counters(Counters const&) = delete;
+    Counters& operator=(Counters const&) = delete;
+    ~Counters()
+    {
+#ifdef SIMPLEJSON_BENCH_PERF
+        for (auto const& event : events_)
+            close(event.fd);
+#endif
+    }
+
+    // Opens what it can; false with a reason when nothing is available
+    bool open(std::string& error)
+    {
+#ifdef SIMPLEJSON_BENCH_PERF
+        auto cache = [](uint64_t cache) {
+            return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        };
+        struct Wanted
+        {
+            char const* name;
+            uint32_t type;
+            uint64_t config;
+        } const wanted[] = {
+            { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { "branch_misses",
+              PERF_TYPE_HARDWARE,
+              PERF_COUNT_HW_BRANCH_MISSES },
+            { "l1d_misses",
+              PERF_TYPE_HW_CACHE,
+              cache(PERF_COUNT_HW_CACHE_L1D) },
+            { "llc_misses", PERF_TYPE_HW_CACHE, cache(PERF_COUNT_HW_CACHE_LL) },
+        };
+        for (auto const& event : wanted) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = event.type;
+            attr.config = event.config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format =
+                PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fd < 0) {
+                error += std::string(error.empty() ? "" : ", ") + event.name +
+                         ": " + std::strerror(errno);
+                continue;
+            }
+            events_.push_back({ event.name, static_cast<int>(fd) });
+        }
+        return !events_.empty();
+#else
+        error = "perf_event_open is not available on this platform";
+        return false;
+#endif
+    }
+
+    void start()
+    {
+#ifdef SIMPLEJSON_BENCH_PERF
+        for (auto const& event : events_) {
+            ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // Counts since start(), divided over the given number of operations
+    std::vector<std::pair<std::string, double>> stop(size_t operations)
+    {
+        std::vector<std::pair<std::string, double>> out{};
+#ifdef SIMPLEJSON_BENCH_PERF
+        for (auto const& event : events_)
+            ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+        for (auto const& event : events_) {
+            // value, time enabled, time running
+            uint64_t values[3]{};
+            if (read(event.fd, values, sizeof(values)) !=
+                    static_cast<ssize_t>(sizeof(values)) ||
+                values[2] == 0)
+                continue;
+            double count = static_cast<double>(values[0]) *
+                           static_cast<double>(values[1]) /
+                           static_cast<double>(values[2]);
+            out.emplace_back(event.name,
+                             count / static_cast<double>(operations));
+        }
+#else
+        (void)operations;
+#endif
+        return out;
+    }
+
+  private:
+    struct Event
+    {
+        char const* name;
+        int fd;
+    };
+    std::vector<Event> events_{};
+};
+
+// set by --counters when at least one counter could be opened
+Counters* counters = nullptr;
+
+struct Node_Counter
+{
+    size_t nodes = 0;
+    bool enter(JSON const&, std::pmr::string const*)
+    {
+        ++nodes;
+        return true;
+    }
+    void leave(JSON const&) {}
+};
+
+size_t count_nodes(JSON const& document)
+{
+    Node_Counter counter{};
+    json::walk(document, counter);
+    return counter.nodes;
+}
+
+std::string word(Random& random)
+{
+    static const char* const words[] = { "alpha", "beta",   "gamma", "delta",
+                                         "kappa", "lambda", "sigma", "omega",
+                                         "node",  "value",  "left",  "right" };
+    return words[random.below(sizeof(words) / sizeof(words[0]))];
+}
+
+std::string number(Random& random)
+{
+    switch (random.below(4)) {
+        case 0:
+            return std::to_string(random.below(1000));
+        case 1:
+            return std::to_string(-static_cast<long>(random.below(1u << 30)));
+        case 2:
+            return std::to_string(random.below(100000)) + "." +
+                   std::to_string(random.below(1000));
+        default:
+            return std::to_string(random.below(10)) + "." +
+                   std::to_string(random.below(1000000)) + "e" +
+                   std::to_string(static_cast<long>(random.below(40)) - 20);
+    }
+}
+
+// Mixed integers, decimals and exponents in one flat array
+std::string numbers_corpus(size_t size, Random& random)
+{
+    std::string out = "[";
+    while (out.size() < size) {
+        if (out.size() > 1)
+            out += ',';
+        out += number(random);
+    }
+    return out + "]";
+}
+
+// Plain words, escapes and multi-byte UTF-8 in one flat array
+std::string strings_corpus(size_t size, Random& random)
+{
+    static const char* const pieces[] = { " ", "\\n", "\\\"", "\\\\",
+                                          "\\u00e9", "\xc3\xa9", "\xe2\x82\xac",
+                                          "\\t" };
+    std::string out = "[";
+    while (out.size() < size) {
+        if (out.size() > 1)
+            out += ',';
+        out += '"';
+        for (size_t n = 1 + random.below(12); n > 0; --n) {
+            out += word(random);
+            out += pieces[random.below(sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        out += '"';
+    }
+    return out + "]";
+}
+
+// Syntax trees shaped like test/cases/ast.json. The first left child
+// continues a spine down to depth levels, other children stay shallow
+void ast_node(std::string& out, Random& random, size_t depth, bool spine)
+{
+    out += "{\"node\":\"" + word(random) + "\",\"root\":";
+    if (random.below(2))
+        out += "\"" + word(random) + "\"";
+    else
+        out += number(random);
+    bool descend = depth > 0 && (spine || random.below(3) == 0);
+    if (descend) {
+        out += ",\"left\":[";
+        for (size_t n = 1 + random.below(2); n > 0; --n) {
+            ast_node(out, random, depth - 1, spine);
+            spine = false;
+            out += n > 1 ? "," : "";
+        }
+        out += "]";
+    }
+    if (descend && random.below(3) == 0) {
+        out += ",\"right\":";
+        ast_node(out, random, depth - 1, false);
+    } else {
+        out += ",\"right\":[null]";
+    }
+    out += "}";
+}
+
+std::string deep_corpus(size_t size, Random& random)
+{
+    std::string out = "[";
+    while (out.size() < size) {
+        if (out.size() > 1)
+            out += ',';
+        ast_node(out, random, 24, true);
+    }
+    return out + "]";
+}
+
+// One object with many members of every type
+std::string wide_corpus(size_t size, Random& random)
+{
+    std::string out = "{";
+    for (size_t i = 0; out.size() < size; ++i) {
+        if (i > 0)
+            out += ',';
+        out += "\"" + word(random) + "_" + std::to_string(i) + "\":";
+        switch (random.below(4)) {
+            case 0:
+                out += number(random);
+                break;
+            case 1:
+                out += "\"" + word(random) + "\"";
+                break;
+            case 2:
+                out += random.below(2) ? "true" : "null";
+                break;
+            default:
+                out += "[" + number(random) + "," + number(random) + "]";
+                break;
+        }
+    }
+    return out + "}";
+}
+
+// Newline-delimited log records
+std::string ndjson_corpus(size_t size, Random& random)
+{
+    std::string out{};
+    for (size_t id = 0; out.size() < size; ++id)
+        out += "{\"id\":" + std::to_string(id) + ",\"user\":\"" +
+               word(random) + "\",\"score\":" + number(random) +
+               ",\"ok\":" + (random.below(2) ? "true" : "false") +
+               ",\"tags\":[\"" + word(random) + "\",\"" + word(random) +
+               "\"]}\n";
+    return out;
+}
+
+std::vector<std::string_view> split_lines(std::string const& text)
+{
+    std::string_view rest = text;
+    std::vector<std::string_view> lines{};
+    for (size_t end = rest.find('\n'); end != std::string_view::npos;
+         rest.remove_prefix(end + 1), end = rest.find('\n'))
+        lines.push_back(rest.substr(0, end));
+    if (!rest.empty())
+        lines.push_back(rest);
+    return lines;
+}
+
+Result measure(std::string const& corpus,
+               std::string const& operation,
+               size_t bytes,
+               double min_time,
+               std::function<void()> const& op)
+{
+    using clock = std::chrono::steady_clock;
+    op(); // warm caches and any lazily built state
+    size_t iterations = 0;
+    size_t before = allocations.load();
+    if (counters)
+        counters->start();
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed{};
+    do {
+        op();
+        ++iterations;
+        elapsed = clock::now() - start;
+    } while (elapsed.count() < min_time || iterations < 3);
+    std::vector<std::pair<std::string, double>> counted{};
+    if (counters)
+        counted = counters->stop(iterations);
+    size_t allocated = allocations.load() - before;
+
+    double seconds = elapsed.count();
+    double per_op = seconds / static_cast<double>(iterations);
+    return Result{ corpus,
+                   operation,
+                   bytes,
+                   iterations,
+                   per_op * 1e9,
+                   static_cast<double>(bytes) / per_op / 1e6,
+                   static_cast<double>(allocated) /
+                       static_cast<double>(iterations),
+                   0,
+                   std::move(counted) };
+}
+
+void run_corpus(Corpus const& corpus,
+                double min_time,
+                std::string const& filter,
+                std::vector<Result>& results)
+{
+    auto wanted = [&](std::string const& operation) {
+        return filter.empty() ||
+               (corpus.name + "/" + operation).find(filter) !=
+                   std::string::npos;
+    };
+    size_t nodes = 0;
+    auto run = [&](std::string const& operation,
+                   size_t bytes,
+                   std::function<void()> const& op) {
+        if (!wanted(operation))
+            return;
+        std::cerr << corpus.name << "/" << operation << "\n";
+        results.push_back(measure(corpus.name, operation, bytes, min_time, op));
+        results.back().nodes = nodes;
+    };
+    size_t bytes = corpus.text.size();
+
+    if (corpus.lines) {
+        auto lines = split_lines(corpus.text);
+        for (auto const& line : lines)
+            nodes += count_nodes(JSON::load(line));
+        run("load", bytes, [&] {
+            for (auto const& line : lines)
+                sink = sink + JSON::load(line).size();
+        });
+        json::Parser parser{};
+        run("parser", bytes, [&] {
+            for (auto const& line : lines)
+                sink = sink + parser.parse(line).size();
+        });
+        return;
+    }
+
+    JSON document = JSON::load(corpus.text);
+    JSON copy = JSON::load(corpus.text);
+    std::string dumped = document.dump();
+    nodes = count_nodes(document);
+
+    run("load", bytes, [&] { sink = sink + JSON::load(corpus.text).size(); });
+
+    // every node from one arena, released at once after each parse
+    std::pmr::monotonic_buffer_resource arena{};
+    json::Options in_arena{};
+    in_arena.resource = &arena;
+    run("load_arena", bytes, [&] {
+        sink = sink + JSON::load(corpus.text, in_arena).size();
+        arena.release();
+    });
+
+    fs::path path = fs::temp_directory_path() /
+                    ("simplejson_bench_" + corpus.name + ".json");
+    if (wanted("load_file")) {
+        std::ofstream(path, std::ios::binary) << corpus.text;
+        run("load_file", bytes, [&] {
+            sink = sink + JSON::load_file(path.string()).size();
+        });
+        fs::remove(path);
+    }
+
+    run("dump", dumped.size(), [&] { sink = sink + document.dump().size(); });
+    run("equal", bytes, [&] { sink = sink + (document == copy); });
+
+    // every member or element of the root, timed per lookup
+    if (wanted("lookup")) {
+        std::vector<std::string> keys{};
+        if (document.JSON_type() == JSON::Class::Object)
+            for (auto const& member : document.object_range())
+                keys.emplace_back(member.first);
+        size_t count = document.JSON_type() == JSON::Class::Object
+                           ? keys.size()
+                           : document.length();
+        JSON const& root = document;
+        auto result = measure(corpus.name, "lookup", 0, min_time, [&] {
+            if (keys.empty())
+                for (size_t i = 0; i < count; ++i)
+                    sink = sink + static_cast<size_t>(
+                                      root.at(static_cast<unsigned>(i))
+                                          .JSON_type());
+            else
+                for (auto const& key : keys)
+                    sink = sink + static_cast<size_t>(root.at(key).JSON_type());
+        });
+        if (count > 0) {
+            result.ns_per_op /= static_cast<double>(count);
+            result.allocations_per_op /= static_cast<double>(count);
+            for (auto& counted : result.counters)
+                counted.second /= static_cast<double>(count);
+        }
+        std::cerr << corpus.name << "/lookup\n";
+        results.push_back(result);
+    }
+
+    run("iterate", bytes, [&] { sink = sink + count_nodes(document); });
+
+    json::Parser parser{};
+    run("parser", bytes, [&] {
+        sink = sink + parser.parse(corpus.text).size();
+    });
+    run("tape", bytes, [&] {
+        sink = sink + json::Tape_Document::load(corpus.text).size();
+    });
+}
+
+void report(std::vector<Result> const& results,
+            size_t size,
+            double min_time,
+            std::string const& counters_error,
+            std::ostream& out)
+{
+    json::Writer writer;
+    writer.begin_object();
+    writer.key("library");
+    writer.string("simplejson");
+#ifdef SIMPLEJSON_VERSION
+    writer.key("version");
+    writer.string(SIMPLEJSON_VERSION);
+#endif
+#if defined(__VERSION__)
+    writer.key("compiler");
+    writer.string(__VERSION__);
+#elif defined(_MSC_FULL_VER)
+    writer.key("compiler");
+    writer.string("MSVC " + std::to_string(_MSC_FULL_VER));
+#endif
+    writer.key("cplusplus");
+    writer.integral(__cplusplus);
+    writer.key("corpus_size");
+    writer.integral(static_cast<long>(size));
+    writer.key("min_time");
+    writer.floating(min_time);
+    if (!counters_error.empty()) {
+        writer.key("counters_unavailable");
+        writer.string(counters_error);
+    }
+    writer.key("benchmarks");
+    writer.begin_array();
+    for (auto const& result : results) {
+        writer.begin_object();
+        writer.key("corpus");
+        writer.string(result.corpus);
+        writer.key("operation");
+        writer.string(result.operation);
+        writer.key("bytes");
+        writer.integral(static_cast<long>(result.bytes));
+        writer.key("iterations");
+        writer.integral(static_cast<long>(result.iterations));
+        writer.key("ns_per_op");
+        writer.floating(result.ns_per_op);
+        if (result.bytes > 0) {
+            writer.key("mb_per_s");
+            writer.floating(result.mb_per_s);
+        }
+        writer.key("allocations_per_op");
+        writer.floating(result.allocations_per_op);
+        if (!result.counters.empty()) {
+            // lookups are already per member, so only per op applies
+            bool whole = result.bytes > 0;
+            double cycles = 0, instructions = 0;
+            writer.key("counters");
+            writer.begin_object();
+            for (auto const& [name, per_op] : result.counters) {
+                cycles = name == "cycles" ? per_op : cycles;
+                instructions = name == "instructions" ? per_op : instructions;
+                writer.key(name);
+                writer.begin_object();
+                writer.key("per_op");
+                writer.floating(per_op);
+                if (whole) {
+                    writer.key("per_byte");
+                    writer.floating(per_op / static_cast<double>(result.bytes));
+                }
+                if (whole && result.nodes > 0) {
+                    writer.key("per_node");
+                    writer.floating(per_op / static_cast<double>(result.nodes));
+                }
+                writer.end_object();
+            }
+            writer.end_object();
+            if (cycles > 0 && instructions > 0) {
+                writer.key("instructions_per_cycle");
+                writer.floating(instructions / cycles);
+            }
+        }
+        writer.end_object();
+    }
+    writer.end_array();
+    writer.end_object();
+    out << writer.str() << "\n";
+}
+
+} // namespace
+
+// counting replacements; GCC cannot tell that free() pairs with these
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto alignment = std::max(static_cast<size_t>(align), sizeof(void*));
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size == 0 ? 1 : size) == 0)
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char** argv)
+{
+    Counted_Resource counted{};
+    std::pmr::set_default_resource(&counted);
+
+    size_t size = 1 << 20;
+    double min_time = 0.5;
+    std::string filter{};
+    bool use_counters = false;
+    std::vector<std::string> files{};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value) {
+            size = std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--min-time" && has_value) {
+            min_time = std::strtod(argv[++i], nullptr);
+        } else if (arg == "--filter" && has_value) {
+            filter = argv[++i];
+        } else if (arg == "--counters") {
+            use_counters = true;
+        } else if (arg.substr(0, 2) == "--") {
+            std::cerr << "usage: " << argv[0]
+                      << " [--size BYTES] [--min-time SECONDS]"
+                         " [--filter TEXT] [--counters] [FILE...]\n";
+            return 2;
+        } else {
+            files.emplace_back(arg);
+        }
+    }
+
+    std::vector<Corpus> corpora{};
+    Random random{};
+    corpora.push_back({ "numbers", numbers_corpus(size, random) });
+    corpora.push_back({ "strings", strings_corpus(size, random) });
+    corpora.push_back({ "deep", deep_corpus(size, random) });
+    corpora.push_back({ "wide", wide_corpus(size, random) });
+    corpora.push_back({ "ndjson", ndjson_corpus(size, random), true });
+
+#ifdef SIMPLEJSON_BENCH_CORPUS
+    if (files.empty() && fs::exists(SIMPLEJSON_BENCH_CORPUS))
+        files.emplace_back(SIMPLEJSON_BENCH_CORPUS);
+#endif
+    for (auto const& file : files) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::cerr << "ERROR: cannot read '" << file << "'\n";
+            return 1;
+        }
+        std::string text((std::istreambuf_iterator<char>(in)),
+                         std::istreambuf_iterator<char>());
+        corpora.push_back({ fs::path(file).stem().string(), std::move(text) });
+    }
+
+    Counters hardware{};
+    std::string counters_error{};
+    if (use_counters) {
+        if (hardware.open(counters_error))
+            counters = &hardware;
+        if (!counters_error.empty())
+            std::cerr << "WARNING: counters unavailable: " << counters_error
+                      << "\n";
+    }
+
+    std::vector<Result> results{};
+    for (auto const& corpus : corpora)
+        run_corpus(corpus, min_time, filter, results);
+    report(results, size, min_time, counters_error, std::cout);
+    return 0;
+}
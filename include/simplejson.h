@@ -21,980 +21,8704 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <charconv>
+#include <climits>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <deque>
 #include <filesystem>
 #include <fstream>
 #include <initializer_list>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <type_traits>
+#include <unordered_set>
+#include <utility>
 #include <variant>
 #include <vector>
+#if __cplusplus >= 202002L
+#include <bit>
+#endif
+
+#if !defined(SIMPLEJSON_NO_SIMD) &&                                           \
+    (defined(__SSE2__) || defined(_M_X64) ||                                  \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <immintrin.h>
+#define SIMPLEJSON_SSE2 1
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define SIMPLEJSON_AVX2 1
+#endif
+#elif !defined(SIMPLEJSON_NO_SIMD) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMPLEJSON_NEON 1
+#endif
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+#if !defined(SIMPLEJSON_NO_MMAP) && __has_include(<sys/mman.h>) &&            \
+    __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SIMPLEJSON_MMAP 1
+#endif
+
+namespace json {
+
+class JSON;
+class Projection;
+class Frozen_Document;
+struct Load_Result;
+
+// Parser limits and behaviour for JSON::load and JSON::load_file
+struct Options
+{
+    // containers nested deeper than this are rejected instead of parsed
+    size_t max_depth = 1024;
+    // keep numbers as their source text, converted only when read
+    bool lazy_numbers = false;
+    // arrays of numbers all integral or all floating are stored unboxed,
+    // see JSON::as_doubles
+    bool packed_arrays = true;
+    // where the document's nodes are allocated, see Resource_Scope
+    std::pmr::memory_resource* resource = nullptr;
+};
+
+// JSON text with zero padding for in-place parsing by JSON::load
+class Padded_String
+{
+  public:
+    static constexpr size_t padding = 64;
+
+    Padded_String()
+        : Padded_String(size_t{ 0 })
+    {
+    }
+
+    // size zero bytes, to be filled through data()
+    explicit Padded_String(size_t size)
+        : buffer_(std::make_unique<char[]>(size + padding))
+        , size_(size)
+    {
+    }
+
+    explicit Padded_String(std::string_view text)
+        : Padded_String(text.size())
+    {
+        if (!text.empty())
+            std::memcpy(buffer_.get(), text.data(), text.size());
+    }
+
+    inline char* data() noexcept { return buffer_.get(); }
+    inline const char* data() const noexcept { return buffer_.get(); }
+    inline size_t size() const noexcept { return size_; }
+    inline std::string_view view() const noexcept { return { data(), size_ }; }
+
+  private:
+    std::unique_ptr<char[]> buffer_;
+    size_t size_;
+};
+
+// first load error: code, offset, line, column and JSON pointer
+struct Parse_Error
+{
+    enum class Code
+    {
+        none,
+        unexpected_end,
+        unexpected_character,
+        expected_key,
+        expected_colon,
+        expected_comma,
+        invalid_number,
+        invalid_literal,
+        unterminated_string,
+        control_character,
+        invalid_escape,
+        invalid_unicode_escape,
+        unpaired_surrogate,
+        invalid_utf8,
+        max_depth,
+        trailing_content
+    };
+
+    Code code = Code::none;
+    size_t offset = 0;
+    size_t line = 0;
+    size_t column = 0;
+    std::string pointer{};
+
+    explicit operator bool() const noexcept { return code != Code::none; }
+
+    // set line and column from offset into the input that failed
+    inline void locate(std::string_view input) noexcept
+    {
+        line = 1;
+        size_t line_start = 0;
+        for (size_t i = 0; i < offset && i < input.size(); ++i) {
+            if (input[i] == '\n') {
+                ++line;
+                line_start = i + 1;
+            }
+        }
+        column = offset - line_start + 1;
+    }
+
+    std::string_view message() const noexcept
+    {
+        switch (code) {
+            case Code::none:
+                return "No error";
+            case Code::unexpected_end:
+                return "Unexpected end of input";
+            case Code::unexpected_character:
+                return "Unexpected character";
+            case Code::expected_key:
+                return "Expected string key";
+            case Code::expected_colon:
+                return "Expected colon";
+            case Code::expected_comma:
+                return "Expected comma or closing bracket";
+            case Code::invalid_number:
+                return "Invalid number";
+            case Code::invalid_literal:
+                return "Expected 'true', 'false' or 'null'";
+            case Code::unterminated_string:
+                return "Unterminated string";
+            case Code::control_character:
+                return "Unescaped control character";
+            case Code::invalid_escape:
+                return "Invalid escape";
+            case Code::invalid_unicode_escape:
+                return "Expected hex character in unicode escape";
+            case Code::unpaired_surrogate:
+                return "Unpaired surrogate in unicode escape";
+            case Code::invalid_utf8:
+                return "Invalid UTF-8";
+            case Code::max_depth:
+                return "Maximum nesting depth exceeded";
+            case Code::trailing_content:
+                return "Unexpected content after the value";
+        }
+        return "Unknown error";
+    }
+};
+
+// why a snapshot could not be written or opened
+struct Snapshot_Error
+{
+    enum class Code
+    {
+        none,
+        cannot_write,
+        cannot_read,
+        not_a_snapshot,
+        incompatible,
+        misaligned,
+        truncated,
+        corrupt
+    };
+
+    Code code = Code::none;
+
+    explicit operator bool() const noexcept { return code != Code::none; }
+
+    std::string_view message() const noexcept
+    {
+        switch (code) {
+            case Code::none:
+                return "No error";
+            case Code::cannot_write:
+                return "Cannot write the snapshot file";
+            case Code::cannot_read:
+                return "Cannot read the snapshot file";
+            case Code::not_a_snapshot:
+                return "Not a snapshot";
+            case Code::incompatible:
+                return "Written by an incompatible build";
+            case Code::misaligned:
+                return "Snapshot data is not 8-byte aligned";
+            case Code::truncated:
+                return "Truncated snapshot";
+            case Code::corrupt:
+                return "Corrupt snapshot";
+        }
+        return "Unknown error";
+    }
+};
+
+///////////////////////
+// Statistics
+//////////////////////
+
+// per-thread load/dump counters, zero unless built with SIMPLEJSON_STATS
+struct Stats
+{
+#ifdef SIMPLEJSON_STATS
+    static constexpr bool enabled = true;
+#else
+    static constexpr bool enabled = false;
+#endif
+
+    uint64_t loads = 0;
+    uint64_t dumps = 0;
+    uint64_t bytes_read = 0;
+    uint64_t bytes_written = 0;
+    // values built, indexed by JSON::Class
+    std::array<uint64_t, 7> nodes{};
+    uint64_t max_depth = 0;
+    uint64_t strings = 0;
+    uint64_t escapes = 0;
+    // made by loads through the document's memory resource
+    uint64_t allocations = 0;
+    uint64_t bytes_allocated = 0;
+    // whole calls, and the phases inside load; scanning is the remainder
+    uint64_t load_ns = 0;
+    uint64_t read_ns = 0;
+    uint64_t string_ns = 0;
+    uint64_t number_ns = 0;
+    uint64_t build_ns = 0;
+    uint64_t dump_ns = 0;
+
+    // Counters of the calling thread
+    static Stats local();
+
+    // Totals over every thread, including threads that have exited
+    static Stats snapshot();
+
+    // Zero the counters of every thread
+    static void reset();
+
+    JSON to_json() const;
+};
+
+namespace detail {
+
+enum Stat : size_t
+{
+    stat_loads,
+    stat_dumps,
+    stat_bytes_read,
+    stat_bytes_written,
+    stat_nodes,
+    stat_max_depth = stat_nodes + 7,
+    stat_strings,
+    stat_escapes,
+    stat_allocations,
+    stat_bytes_allocated,
+    stat_load_ns,
+    stat_read_ns,
+    stat_string_ns,
+    stat_number_ns,
+    stat_build_ns,
+    stat_dump_ns,
+    stat_count
+};
+
+#ifdef SIMPLEJSON_STATS
+
+using Stat_Values = std::array<uint64_t, stat_count>;
+
+// one thread's counters, written only by that thread
+struct Stats_Slot
+{
+    std::array<std::atomic<uint64_t>, stat_count> values{};
+
+    inline Stat_Values load() const noexcept
+    {
+        Stat_Values out{};
+        for (size_t i = 0; i < stat_count; ++i)
+            out[i] = values[i].load(std::memory_order_relaxed);
+        return out;
+    }
+};
+
+inline void merge_stats(Stat_Values& into, Stat_Values const& from) noexcept
+{
+    for (size_t i = 0; i < stat_count; ++i)
+        into[i] = i == stat_max_depth ? std::max(into[i], from[i])
+                                      : into[i] + from[i];
+}
+
+struct Stats_Registry
+{
+    std::mutex mutex{};
+    std::vector<Stats_Slot*> live{};
+    // totals of threads that have exited
+    Stat_Values retired{};
+
+    static Stats_Registry& get()
+    {
+        static Stats_Registry registry{};
+        return registry;
+    }
+};
+
+struct Stats_Thread
+{
+    Stats_Slot slot{};
+
+    Stats_Thread()
+    {
+        auto& registry = Stats_Registry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(&slot);
+    }
+    ~Stats_Thread()
+    {
+        auto& registry = Stats_Registry::get();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        merge_stats(registry.retired, slot.load());
+        registry.live.erase(
+            std::find(registry.live.begin(), registry.live.end(), &slot));
+    }
+};
+
+inline Stats_Slot& stats_slot()
+{
+    thread_local Stats_Thread thread{};
+    return thread.slot;
+}
+
+inline Stats to_stats(Stat_Values const& v)
+{
+    Stats stats{};
+    stats.loads = v[stat_loads];
+    stats.dumps = v[stat_dumps];
+    stats.bytes_read = v[stat_bytes_read];
+    stats.bytes_written = v[stat_bytes_written];
+    for (size_t i = 0; i < stats.nodes.size(); ++i)
+        stats.nodes[i] = v[stat_nodes + i];
+    stats.max_depth = v[stat_max_depth];
+    stats.strings = v[stat_strings];
+    stats.escapes = v[stat_escapes];
+    stats.allocations = v[stat_allocations];
+    stats.bytes_allocated = v[stat_bytes_allocated];
+    stats.load_ns = v[stat_load_ns];
+    stats.read_ns = v[stat_read_ns];
+    stats.string_ns = v[stat_string_ns];
+    stats.number_ns = v[stat_number_ns];
+    stats.build_ns = v[stat_build_ns];
+    stats.dump_ns = v[stat_dump_ns];
+    return stats;
+}
+
+#endif
+
+// Add to a counter of this thread; no atomic read-modify-write needed
+inline void count(Stat stat, uint64_t amount = 1) noexcept
+{
+#ifdef SIMPLEJSON_STATS
+    auto& value = stats_slot().values[stat];
+    if (stat == stat_max_depth)
+        amount = std::max(amount, value.load(std::memory_order_relaxed));
+    else
+        amount += value.load(std::memory_order_relaxed);
+    value.store(amount, std::memory_order_relaxed);
+#else
+    (void)stat;
+    (void)amount;
+#endif
+}
+
+// Adds the nanoseconds of its lifetime to a counter, empty when disabled
+class Stats_Timer
+{
+  public:
+#ifdef SIMPLEJSON_STATS
+    explicit Stats_Timer(Stat stat) noexcept
+        : stat_(stat)
+        , start_(std::chrono::steady_clock::now())
+    {
+    }
+    ~Stats_Timer()
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        count(stat_,
+              static_cast<uint64_t>(
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                      .count()));
+    }
+
+  private:
+    Stat stat_;
+    std::chrono::steady_clock::time_point start_;
+#else
+    explicit constexpr Stats_Timer(Stat) noexcept {}
+#endif
+};
+
+} // namespace detail
+
+inline Stats Stats::local()
+{
+#ifdef SIMPLEJSON_STATS
+    return detail::to_stats(detail::stats_slot().load());
+#else
+    return Stats{};
+#endif
+}
+
+inline Stats Stats::snapshot()
+{
+#ifdef SIMPLEJSON_STATS
+    auto& registry = detail::Stats_Registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    detail::Stat_Values totals = registry.retired;
+    for (auto const* slot : registry.live)
+        detail::merge_stats(totals, slot->load());
+    return detail::to_stats(totals);
+#else
+    return Stats{};
+#endif
+}
+
+inline void Stats::reset()
+{
+#ifdef SIMPLEJSON_STATS
+    auto& registry = detail::Stats_Registry::get();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.retired = detail::Stat_Values{};
+    for (auto* slot : registry.live)
+        for (auto& value : slot->values)
+            value.store(0, std::memory_order_relaxed);
+#endif
+}
+
+///////////////////////
+// Tracing
+//////////////////////
+
+// 'B' opens a span, 'E' closes it, 'X' is a complete span
+struct Trace_Event
+{
+    char const* name;
+    char phase;
+    uint64_t timestamp_ns;
+    uint64_t duration_ns;
+    uint64_t bytes;
+    uint32_t thread;
+};
+
+// span receiver for SIMPLEJSON_TRACE builds, must be thread-safe
+class Trace_Sink
+{
+  public:
+    virtual ~Trace_Sink() = default;
+    virtual void event(Trace_Event const& event) noexcept = 0;
+
+    // containers spanning fewer input bytes get no span of their own
+    size_t subtree_bytes = size_t{ 1 } << 16;
+};
+
+namespace detail {
+
+#ifdef SIMPLEJSON_TRACE
+inline constexpr bool trace_enabled = true;
+#else
+inline constexpr bool trace_enabled = false;
+#endif
+
+inline std::atomic<Trace_Sink*>& trace_sink() noexcept
+{
+    static std::atomic<Trace_Sink*> sink{ nullptr };
+    return sink;
+}
+
+// Installed sink, or nullptr; always nullptr when tracing is compiled out
+inline Trace_Sink* current_trace_sink() noexcept
+{
+    if constexpr (!trace_enabled)
+        return nullptr;
+    return trace_sink().load(std::memory_order_acquire);
+}
+
+inline uint64_t trace_now() noexcept
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+// Small sequential thread ids, as trace viewers draw one row per id
+inline uint32_t trace_thread() noexcept
+{
+    static std::atomic<uint32_t> next{ 1 };
+    thread_local uint32_t id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+// Emits 'B' and 'E' around its lifetime, empty when disabled
+class Trace_Span
+{
+  public:
+#ifdef SIMPLEJSON_TRACE
+    Trace_Span(char const* name, uint64_t bytes) noexcept
+        : name_(name)
+        , bytes_(bytes)
+        , sink_(current_trace_sink())
+    {
+        emit('B');
+    }
+    ~Trace_Span() { emit('E'); }
+    Trace_Span(Trace_Span const&) = delete;
+    Trace_Span& operator=(Trace_Span const&) = delete;
+
+    // Size reported on the closing event, once it is known
+    void bytes(uint64_t bytes) noexcept { bytes_ = bytes; }
+
+  private:
+    void emit(char phase) noexcept
+    {
+        if (sink_)
+            sink_->event({ name_, phase, trace_now(), 0, bytes_,
+                           trace_thread() });
+    }
+
+    char const* name_;
+    uint64_t bytes_;
+    Trace_Sink* sink_;
+#else
+    constexpr Trace_Span(char const*, uint64_t) noexcept {}
+    constexpr void bytes(uint64_t) noexcept {}
+#endif
+};
+
+// Where and when a container opened, empty when disabled
+struct Trace_Mark
+{
+#ifdef SIMPLEJSON_TRACE
+    uint64_t timestamp_ns = 0;
+    size_t offset = 0;
+#endif
+};
+
+inline Trace_Mark trace_mark(Trace_Sink* sink, size_t offset) noexcept
+{
+    Trace_Mark mark{};
+#ifdef SIMPLEJSON_TRACE
+    if (sink)
+        mark = Trace_Mark{ trace_now(), offset };
+#else
+    (void)sink;
+    (void)offset;
+#endif
+    return mark;
+}
+
+// Complete span for a container closing at offset, if it is large enough
+inline void trace_subtree(Trace_Sink* sink,
+                          Trace_Mark const& mark,
+                          size_t offset) noexcept
+{
+#ifdef SIMPLEJSON_TRACE
+    size_t bytes = offset - mark.offset;
+    if (!sink || bytes < sink->subtree_bytes)
+        return;
+    uint64_t now = trace_now();
+    sink->event({ "subtree",
+                  'X',
+                  mark.timestamp_ns,
+                  now - mark.timestamp_ns,
+                  bytes,
+                  trace_thread() });
+#else
+    (void)sink;
+    (void)mark;
+    (void)offset;
+#endif
+}
+
+} // namespace detail
+
+// install the sink for every thread, nullptr stops tracing; loads and
+// dumps already running keep the sink they started with
+inline Trace_Sink* set_trace_sink(Trace_Sink* sink) noexcept
+{
+    return detail::trace_sink().exchange(sink, std::memory_order_acq_rel);
+}
+
+// writes Chrome trace-event JSON for chrome://tracing and Perfetto
+class Chrome_Trace_Writer : public Trace_Sink
+{
+  public:
+    explicit Chrome_Trace_Writer(std::string_view path)
+        : out_(std::string(path), std::ios::out | std::ios::binary)
+        , origin_ns_(detail::trace_now())
+    {
+        buffer_ = "[";
+    }
+    // Uninstalls the writer, but spans of loads and dumps still running
+    // hold it: let them finish before the writer is destroyed
+    ~Chrome_Trace_Writer() override
+    {
+        Trace_Sink* self = this;
+        detail::trace_sink().compare_exchange_strong(self, nullptr);
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer_ += "\n]\n";
+        write();
+    }
+    Chrome_Trace_Writer(Chrome_Trace_Writer const&) = delete;
+    Chrome_Trace_Writer& operator=(Chrome_Trace_Writer const&) = delete;
+
+    bool is_open() const { return out_.is_open() && out_.good(); }
+
+    void event(Trace_Event const& event) noexcept override
+    {
+        // microseconds since the writer was created
+        auto micros = [this](uint64_t ns) {
+            return static_cast<double>(ns - std::min(ns, origin_ns_)) / 1e3;
+        };
+        char duration[48] = "";
+        if (event.phase == 'X')
+            std::snprintf(duration,
+                          sizeof(duration),
+                          ",\"dur\":%.3f",
+                          static_cast<double>(event.duration_ns) / 1e3);
+        char line[256];
+        std::lock_guard<std::mutex> lock(mutex_);
+        int length = std::snprintf(
+            line,
+            sizeof(line),
+            "%s\n{\"name\":\"%s\",\"cat\":\"simplejson\",\"ph\":\"%c\","
+            "\"ts\":%.3f%s,\"pid\":1,\"tid\":%u,\"args\":{\"bytes\":%llu}}",
+            first_ ? "" : ",",
+            event.name,
+            event.phase,
+            micros(event.timestamp_ns),
+            duration,
+            event.thread,
+            static_cast<unsigned long long>(event.bytes));
+        if (length < 0 || static_cast<size_t>(length) >= sizeof(line))
+            return;
+        try {
+            buffer_.append(line, static_cast<size_t>(length));
+        } catch (...) {
+            return;
+        }
+        first_ = false;
+        if (buffer_.size() >= batch)
+            write();
+    }
+
+    // Write out buffered events
+    void flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write();
+        out_.flush();
+    }
+
+  private:
+    static constexpr size_t batch = 1 << 16;
+
+    void write()
+    {
+        out_.write(buffer_.data(),
+                   static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+    std::mutex mutex_{};
+    std::ofstream out_;
+    std::string buffer_{};
+    uint64_t origin_ns_;
+    bool first_ = true;
+};
+
+namespace detail {
+
+inline std::pmr::memory_resource*& scoped_resource() noexcept
+{
+    thread_local std::pmr::memory_resource* resource = nullptr;
+    return resource;
+}
+
+inline std::pmr::memory_resource* current_resource() noexcept
+{
+    auto* resource = scoped_resource();
+    return resource ? resource : std::pmr::get_default_resource();
+}
+
+// Options::resource when set, else whatever scope is already in effect
+inline std::pmr::memory_resource* resource_for(Options const& options) noexcept
+{
+    return options.resource ? options.resource : scoped_resource();
+}
+
+} // namespace detail
+
+// allocate nodes created on this thread from resource while alive
+class Resource_Scope
+{
+  public:
+    explicit Resource_Scope(std::pmr::memory_resource* resource) noexcept
+        : previous_(std::exchange(detail::scoped_resource(), resource))
+    {
+    }
+    ~Resource_Scope() { detail::scoped_resource() = previous_; }
+    Resource_Scope(Resource_Scope const&) = delete;
+    Resource_Scope& operator=(Resource_Scope const&) = delete;
+
+  private:
+    std::pmr::memory_resource* previous_;
+};
+
+namespace detail {
+
+#ifdef SIMPLEJSON_STATS
+
+// Passes allocations on to upstream, counting those made while a load
+// runs on the calling thread
+class Counting_Resource : public std::pmr::memory_resource
+{
+  public:
+    explicit Counting_Resource(std::pmr::memory_resource* upstream) noexcept
+        : upstream_(upstream)
+    {
+    }
+
+    // The wrapper of upstream. Documents keep the resource they were
+    // built with, so wrappers live as long as the process, one for each
+    // upstream address
+    static std::pmr::memory_resource* wrap(
+        std::pmr::memory_resource* upstream)
+    {
+        if (dynamic_cast<Counting_Resource*>(upstream))
+            return upstream;
+        thread_local std::pair<std::pmr::memory_resource*,
+                               std::pmr::memory_resource*>
+            last{ nullptr, nullptr };
+        if (last.first == upstream)
+            return last.second;
+        static std::mutex mutex{};
+        static auto* wrappers =
+            new std::map<std::pmr::memory_resource*, Counting_Resource*>();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& wrapper = (*wrappers)[upstream];
+        if (!wrapper)
+            wrapper = new Counting_Resource(upstream);
+        last = { upstream, wrapper };
+        return wrapper;
+    }
+
+    inline std::pmr::memory_resource* upstream() const noexcept
+    {
+        return upstream_;
+    }
+
+    // Loads running on this thread
+    static inline unsigned& loading() noexcept
+    {
+        thread_local unsigned depth = 0;
+        return depth;
+    }
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        void* memory = upstream_->allocate(bytes, alignment);
+        if (loading() != 0) {
+            count(stat_allocations);
+            count(stat_bytes_allocated, bytes);
+        }
+        return memory;
+    }
+    void do_deallocate(void* memory, size_t bytes, size_t alignment) override
+    {
+        upstream_->deallocate(memory, bytes, alignment);
+    }
+    bool do_is_equal(
+        std::pmr::memory_resource const& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+};
+
+#endif
+
+// The resource as the caller gave it, without the counting wrapper
+inline std::pmr::memory_resource* user_resource(
+    std::pmr::memory_resource* resource) noexcept
+{
+#ifdef SIMPLEJSON_STATS
+    if (auto* counting = dynamic_cast<Counting_Resource*>(resource))
+        return counting->upstream();
+#endif
+    return resource;
+}
+
+// Resource for a load: counted when built with SIMPLEJSON_STATS
+class Load_Scope
+{
+  public:
+    explicit Load_Scope(Options const& options)
+#ifdef SIMPLEJSON_STATS
+        : scope_(Counting_Resource::wrap(options.resource
+                                             ? options.resource
+                                             : current_resource()))
+    {
+        ++Counting_Resource::loading();
+    }
+    ~Load_Scope() { --Counting_Resource::loading(); }
+#else
+        : scope_(resource_for(options))
+    {
+    }
+#endif
+    Load_Scope(Load_Scope const&) = delete;
+    Load_Scope& operator=(Load_Scope const&) = delete;
+
+  private:
+    Resource_Scope scope_;
+};
+
+// orders keys of any string type without converting them
+struct Key_Less
+{
+    using is_transparent = void;
+    inline bool operator()(std::string_view a, std::string_view b) const
+    {
+        return a < b;
+    }
+};
+
+// strings and keys allocate from the resource of the node holding them
+using JSON_Deque = std::pmr::deque<JSON>;
+using JSON_String = std::pmr::string;
+using JSON_Map = std::pmr::map<JSON_String, JSON, Key_Less>;
+using JSON_Deque_PTR = std::shared_ptr<JSON_Deque>;
+using JSON_String_PTR = std::shared_ptr<JSON_String>;
+using JSON_Map_PTR = std::shared_ptr<JSON_Map>;
+
+// unboxed numeric array elements, nodes built once on first access
+struct Packed_Array
+{
+    using allocator_type = std::pmr::polymorphic_allocator<double>;
+
+    explicit Packed_Array(allocator_type const& allocator)
+        : doubles(allocator)
+        , integers(allocator)
+    {
+    }
+
+    inline size_t size() const noexcept
+    {
+        return floating ? doubles.size() : integers.size();
+    }
+
+    // element index as a node of its own
+    inline JSON at(size_t index) const;
+
+    // the elements as nodes, built on first use by any copy
+    inline JSON_Deque_PTR const& nodes() const;
+
+    bool floating = false;
+    std::pmr::vector<double> doubles;
+    std::pmr::vector<long> integers;
+    // set once the nodes were handed out for writing; the numbers above
+    // are stale from then on
+    std::atomic<bool> boxed{ false };
+
+  private:
+    mutable std::once_flag built_{};
+    mutable JSON_Deque_PTR nodes_{};
+};
+
+using Packed_Array_PTR = std::shared_ptr<Packed_Array>;
+
+// The packed elements of an array, nullptr for other values and once the
+// elements were written through nodes
+inline Packed_Array* packed_array(JSON const& value) noexcept;
+
+// The elements of an array as nodes, see Packed_Array::nodes
+inline JSON_Deque_PTR const& array_nodes(JSON const& value);
+
+// The member named key, added as null when missing
+inline JSON& member(JSON_Map& map, std::string_view key);
+
+template<typename T>
+inline constexpr bool is_Object_Variant =
+    std::is_same_v<T, JSON_Deque> || std::is_same_v<T, JSON_String> ||
+    std::is_same_v<T, JSON_Map>;
+
+template<typename T>
+inline constexpr bool is_Object_Variant_Pointer =
+    std::is_same_v<T, JSON_Deque_PTR> || std::is_same_v<T, JSON_String_PTR> ||
+    std::is_same_v<T, JSON_Map_PTR>;
+
+// shared block and object in one allocation from the current resource
+template<typename Type,
+         typename... Args,
+         typename = std::enable_if_t<is_Object_Variant<Type> ||
+                                     std::is_same_v<Type, Packed_Array>>>
+inline std::shared_ptr<Type> make_data_object(Args&&... args)
+{
+    return std::allocate_shared<Type>(
+        std::pmr::polymorphic_allocator<Type>(current_resource()),
+        std::forward<Args>(args)...);
+}
+
+template<typename Type>
+Type get_safe_data_object(std::optional<std::shared_ptr<Type>> const& type);
+
+inline std::string unquote(std::string_view raw);
+
+#if __cplusplus >= 202002L
+constexpr inline std::string json_escape(std::string_view str)
+#else
+inline std::string json_escape(std::string_view str)
+#endif
+{
+    std::string output;
+    for (unsigned i = 0; i < str.length(); ++i)
+        switch (str[i]) {
+            case '\"':
+                output += "\\\"";
+                break;
+            case '\\':
+                output += "\\\\";
+                break;
+            case '\b':
+                output += "\\b";
+                break;
+            case '\f':
+                output += "\\f";
+                break;
+            case '\n':
+                output += "\\n";
+                break;
+            case '\r':
+                output += "\\r";
+                break;
+            case '\t':
+                output += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(str[i]) < 0x20) {
+                    output += "\\u00";
+                    output += "0123456789abcdef"[(str[i] >> 4) & 0xF];
+                    output += "0123456789abcdef"[str[i] & 0xF];
+                } else {
+                    output += str[i];
+                }
+                break;
+        }
+    return output;
+}
+
+// string stored inline in the node
+struct Short_String
+{
+    static constexpr size_t capacity = 15;
+
+    char data[capacity]{};
+    uint8_t size = 0;
+
+    static constexpr Short_String from(std::string_view text) noexcept
+    {
+        Short_String out{};
+        for (size_t i = 0; i < text.size(); ++i)
+            out.data[i] = text[i];
+        out.size = static_cast<uint8_t>(text.size());
+        return out;
+    }
+
+    constexpr std::string_view view() const noexcept { return { data, size }; }
+
+    friend constexpr bool operator==(Short_String const& a,
+                                     Short_String const& b) noexcept
+    {
+        return a.view() == b.view();
+    }
+    friend constexpr bool operator!=(Short_String const& a,
+                                     Short_String const& b) noexcept
+    {
+        return !(a == b);
+    }
+};
+
+} // namespace detail
+
+// read-only view of a packed array's elements
+template<typename T>
+class Packed_View
+{
+  public:
+    constexpr Packed_View() noexcept = default;
+    constexpr Packed_View(T const* data, size_t size) noexcept
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    constexpr inline T const* data() const noexcept { return data_; }
+    constexpr inline size_t size() const noexcept { return size_; }
+    constexpr inline bool empty() const noexcept { return size_ == 0; }
+    constexpr inline T const* begin() const noexcept { return data_; }
+    constexpr inline T const* end() const noexcept { return data_ + size_; }
+    constexpr inline T const& operator[](size_t index) const noexcept
+    {
+        return data_[index];
+    }
+
+  private:
+    T const* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class JSON
+{
+  public:
+    enum class Class
+    {
+        Null,
+        Object,
+        Array,
+        String,
+        Floating,
+        Integral,
+        Boolean
+    };
+
+  public:
+  public:
+    JSON()
+        : Internal()
+        , Type(Class::Null)
+    {
+    }
+    explicit JSON(std::initializer_list<JSON> list)
+        : JSON()
+    {
+        set_type(Class::Object);
+        for (auto const& i : list) {
+            this->operator[](i.to_string()) = i;
+        }
+    }
+
+    explicit JSON(std::deque<JSON> const& list)
+        : JSON()
+    {
+        set_type(Class::Array);
+        for (auto const& i : list) {
+            append(i);
+        }
+    }
+
+    explicit JSON(JSON&& other)
+        : Internal(std::move(other.Internal))
+        , Type(std::move(other.Type))
+    {
+    }
+    JSON const& operator=(JSON&& other)
+    {
+        if (this != &other) {
+            // other may live inside this tree, so take its data first
+            internal data = std::move(other.Internal);
+            Class type = other.Type;
+            release();
+            Internal = std::move(data);
+            Type = type;
+        }
+        return *this;
+    }
+    JSON(const JSON& other)
+        : Internal(other.Internal)
+        , Type(other.Type)
+    {
+    }
+
+    JSON& operator=(const JSON& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        // other may live inside this tree, so hold its data before release
+        internal data = other.Internal;
+        Class type = other.Type;
+        release();
+        Internal = std::move(data);
+        Type = type;
+        return *this;
+    }
+
+    ~JSON() { release(); }
+
+#ifdef CATCH2_TEST_BUILD
+    inline operator std::string() const { return dump(); }
+#endif
+
+    template<typename T>
+    explicit JSON(
+        T b,
+        typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr)
+        : Internal(b)
+        , Type(Class::Boolean)
+    {
+    }
+
+    template<typename T>
+    explicit JSON(
+        T i,
+        typename std::enable_if<std::is_integral<T>::value &&
+                                !std::is_same<T, bool>::value>::type* = nullptr)
+        : Internal(static_cast<long>(i))
+        , Type(Class::Integral)
+    {
+    }
+
+    template<typename T>
+    explicit JSON(
+        T f,
+        typename std::enable_if<std::is_floating_point<T>::value>::type* =
+            nullptr)
+        : Internal(static_cast<double>(f))
+        , Type(Class::Floating)
+    {
+    }
+
+    template<typename T>
+    explicit JSON(
+        T s,
+        typename std::enable_if<
+            std::is_convertible<T, std::string>::value>::type* = nullptr)
+        : Internal(std::string(std::move(s)))
+        , Type(Class::String)
+    {
+    }
+
+    // A string value, adopting the buffer of one from the current resource
+    explicit JSON(detail::JSON_String&& s)
+        : Internal(std::move(s))
+        , Type(Class::String)
+    {
+    }
+
+    // An array over packed numbers, see as_doubles
+    explicit JSON(detail::Packed_Array_PTR packed)
+        : Type(Class::Array)
+    {
+        Internal.data_ = std::move(packed);
+    }
+
+  private:
+    // internal STL-container
+    struct internal
+    {
+        explicit internal(long i)
+            : data_{ i }
+        {
+        }
+        explicit internal(double i)
+            : data_{ i }
+        {
+        }
+        explicit internal(bool i)
+            : data_{ i }
+        {
+        }
+        explicit internal(std::string const& i)
+        {
+            if (i.size() <= detail::Short_String::capacity)
+                data_ = detail::Short_String::from(i);
+            else
+                String = detail::make_data_object<detail::JSON_String>(
+                    std::string_view(i));
+        }
+        // keeps the buffer when it is in the current resource already
+        explicit internal(detail::JSON_String&& i)
+        {
+            if (i.size() <= detail::Short_String::capacity)
+                data_ = detail::Short_String::from(i);
+            else
+                String =
+                    detail::make_data_object<detail::JSON_String>(std::move(i));
+        }
+        internal() = default;
+        std::optional<detail::JSON_Deque_PTR> List;
+        std::optional<detail::JSON_String_PTR> String;
+        std::optional<detail::JSON_Map_PTR> Map;
+        std::variant<std::monostate,
+                     long,
+                     double,
+                     bool,
+                     detail::Short_String,
+                     detail::Packed_Array_PTR>
+            data_ = std::monostate();
+    };
+
+  public:
+    mutable internal Internal{};
+    inline friend std::ostream& operator<<(std::ostream& os, const JSON& json)
+    {
+        os << json.dump();
+        return os;
+    }
+
+    template<typename Type,
+             typename = std::enable_if<detail::is_Object_Variant<Type>>>
+    friend std::optional<std::shared_ptr<Type>> make_data_object()
+    {
+        return detail::make_data_object<Type>();
+    }
+
+    bool operator==(JSON const& other) const noexcept;
+
+    bool inline operator!=(JSON const& rhs) const
+    {
+        return !(this->operator==(rhs));
+    }
+
+    size_t hash() const noexcept;
+
+    // deeply immutable copy, see Frozen_Document
+    Frozen_Document freeze() const;
+
+    // write the snapshot of freeze() to a file, see Mapped_Document
+    bool save_snapshot(std::string_view path) const;
+    bool save_snapshot(std::string_view path, Snapshot_Error& error) const;
+
+    inline std::map<std::string, JSON> make_empty_map() const noexcept
+    {
+        return std::map<std::string, JSON>{};
+    }
+
+    inline std::deque<JSON> make_empty_list() const noexcept
+    {
+        return std::deque<JSON>{};
+    }
+
+#if __cplusplus >= 202002L
+    constexpr inline std::string make_empty_string() const noexcept
+#else
+    inline std::string make_empty_string() const noexcept
+#endif
+    {
+        return std::string{};
+    }
+
+    template<typename Container,
+             typename = std::enable_if<detail::is_Object_Variant<Container>>>
+    class JSON_Wrapper
+    {
+        using Container_PTR = std::shared_ptr<Container>;
+        std::optional<Container_PTR> object;
+
+      public:
+        explicit JSON_Wrapper(Container_PTR val)
+            : object(val)
+        {
+        }
+
+        explicit JSON_Wrapper()
+            : object(std::nullopt)
+        {
+        }
+
+        constexpr inline typename Container::iterator begin() noexcept
+        {
+            return object ? object.value()->begin()
+                          : typename Container::iterator();
+        }
+        constexpr inline typename Container::iterator end() noexcept
+        {
+            return object ? object.value()->end()
+                          : typename Container::iterator();
+        }
+        constexpr inline typename Container::const_iterator begin()
+            const noexcept
+        {
+            return object ? object.value()->begin()
+                          : typename Container::iterator();
+        }
+        constexpr inline typename Container::const_iterator end() const noexcept
+        {
+            return object ? object.value()->end()
+                          : typename Container::iterator();
+        }
+    };
+
+    template<typename Container,
+             typename = std::enable_if<detail::is_Object_Variant<Container>>>
+    class JSON_Const_Wrapper
+    {
+        using Container_PTR = std::shared_ptr<Container>;
+        std::optional<Container_PTR> object;
+
+      public:
+        explicit JSON_Const_Wrapper(Container_PTR const val)
+            : object(val)
+        {
+        }
+        explicit JSON_Const_Wrapper()
+            : object(std::nullopt)
+        {
+        }
+
+        constexpr inline JSON& operator[](int index) const
+        {
+            return object.value()->at(index);
+        }
+        constexpr inline typename Container::const_iterator begin()
+            const noexcept
+        {
+            return object ? object.value()->begin()
+                          : typename Container::const_iterator();
+        }
+        constexpr inline typename Container::const_iterator end() const noexcept
+        {
+            return object ? object.value()->end()
+                          : typename Container::const_iterator();
+        }
+    };
+
+    static inline JSON make(Class type)
+    {
+        JSON ret;
+        ret.set_type(type);
+        return ret;
+    }
+
+    static JSON load(std::string_view) noexcept;
+
+    static JSON load(std::string_view, Options const&) noexcept;
+
+    // Null on malformed input, with the reason in error
+    static JSON load(std::string_view,
+                     Parse_Error& error,
+                     Options const& = Options{}) noexcept;
+
+    static Load_Result try_load(std::string_view,
+                                Options const& = Options{}) noexcept;
+
+    // Parsed in place, without the copy made of other input
+    static JSON load(Padded_String const&, Options const& = Options{}) noexcept;
+
+    static JSON load(Padded_String const&,
+                     Parse_Error& error,
+                     Options const& = Options{}) noexcept;
+
+    static JSON load(std::string_view, Projection const&) noexcept;
+
+    static JSON load(std::string_view,
+                     Projection const&,
+                     Parse_Error& error) noexcept;
+
+    static JSON load_file(std::string_view);
+
+    static JSON load_file(std::string_view, Options const&);
+
+    template<typename T>
+    inline void append(T arg)
+    {
+        set_type(Class::Array);
+        list(true).emplace_back(arg);
+    }
+
+    template<typename T, typename... U>
+    inline void append(T arg, U... args)
+    {
+        append(arg);
+        append(args...);
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_same<T, bool>::value, JSON&>::type
+    operator=(T b)
+    {
+        set_type(Class::Boolean);
+        Internal.data_ = b;
+        return *this;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                                !std::is_same<T, bool>::value,
+                            JSON&>::type
+    operator=(T i)
+    {
+        set_type(Class::Integral);
+        Internal.String.reset();
+        Internal.data_ = static_cast<long>(i);
+        return *this;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_floating_point<T>::value, JSON&>::type
+    operator=(T f)
+    {
+        set_type(Class::Floating);
+        Internal.String.reset();
+        Internal.data_ = static_cast<double>(f);
+        return *this;
+    }
+
+    template<typename T>
+    typename std::enable_if<std::is_convertible<T, std::string>::value,
+                            JSON&>::type
+    operator=(T s)
+    {
+        set_type(Class::String);
+        Internal = internal(std::string(std::move(s)));
+        return *this;
+    }
+
+    inline JSON& operator[](std::string const& key) noexcept
+    {
+        set_type(Class::Object);
+        return detail::member(*Internal.Map.value(), key);
+    }
+
+    inline const JSON& operator[](std::string const& key) const noexcept
+    {
+        set_type(Class::Object);
+        return detail::member(*Internal.Map.value(), key);
+    }
+
+    inline JSON& operator[](unsigned index) noexcept
+    {
+        set_type(Class::Array);
+        auto& list = this->list(true);
+        if (index >= list.size())
+            list.resize(index + 1);
+
+        return list[index];
+    }
+
+    inline JSON& at(const std::string& key)
+    {
+        return detail::member(*Internal.Map.value(), key);
+    }
+
+    inline const JSON& at(const std::string& key) const
+    {
+        set_type(Class::Object);
+        return detail::member(*Internal.Map.value(), key);
+    }
+
+    inline JSON& at(unsigned index) { return operator[](index); }
+
+    inline const JSON& at(unsigned index) const
+    {
+        return list(false)[index];
+    }
+
+    constexpr inline size_t length() const
+    {
+        if (Type == Class::Array)
+            return array_size();
+        else
+            return -1UL;
+    }
+
+    constexpr inline bool has_key(const std::string& key) const
+    {
+        if (Type == Class::Object) {
+#if __cplusplus >= 202002L
+            return Internal.Map.value()->contains(std::string_view(key));
+#else
+            return Internal.Map.value()->find(std::string_view(key)) !=
+                   Internal.Map.value()->end();
+#endif
+        }
+
+        return false;
+    }
+
+    std::vector<std::string> dump_keys() const
+    {
+        auto const& data = *Internal.Map.value();
+        std::vector<std::string> keys{};
+        std::transform(data.begin(),
+                       data.end(),
+                       std::back_inserter(keys),
+                       [](const auto& pair) {
+                           return std::string(pair.first);
+                       });
+        return keys;
+    }
+
+    constexpr inline size_t size() const noexcept
+    {
+        if (Type == Class::Object)
+            return Internal.Map.value()->size();
+        else if (Type == Class::Array)
+            return array_size();
+        else
+            return -1UL;
+    }
+
+    constexpr inline Class JSON_type() const noexcept { return Type; }
+
+    constexpr inline bool is_null() const { return Type == Class::Null; }
+
+#if __cplusplus >= 202002L
+    constexpr inline std::string to_string() const noexcept
+#else
+    inline std::string to_string() const noexcept
+#endif
+    {
+        return Type == Class::String ? detail::json_escape(text())
+                                     : std::string("");
+    }
+
+    // Unescaped text of a string value, valid until the value changes;
+    // empty for other values
+#if __cplusplus >= 202002L
+    constexpr inline std::string_view text() const noexcept
+#else
+    inline std::string_view text() const noexcept
+#endif
+    {
+        if (Type != Class::String)
+            return {};
+        if (Internal.String)
+            return *Internal.String.value();
+        return std::get<detail::Short_String>(Internal.data_).view();
+    }
+
+    inline std::deque<JSON> to_deque() const noexcept
+    {
+        if (Type != Class::Array)
+            return make_empty_list();
+        if (auto const* packed = detail::packed_array(*this)) {
+            std::deque<JSON> list{};
+            for (size_t i = 0; i < packed->size(); ++i)
+                list.push_back(packed->at(i));
+            return list;
+        }
+        auto const& list = this->list(false);
+        return std::deque<JSON>(list.begin(), list.end());
+    }
+
+    // packed floating elements, empty unless Options::packed_arrays
+    // applied; stale once the array is written to
+    inline Packed_View<double> as_doubles() const noexcept
+    {
+        auto const* packed = detail::packed_array(*this);
+        if (!packed || !packed->floating)
+            return {};
+        return { packed->doubles.data(), packed->doubles.size() };
+    }
+
+    // Elements of an array read as all integers, as as_doubles
+    inline Packed_View<long> as_integers() const noexcept
+    {
+        auto const* packed = detail::packed_array(*this);
+        if (!packed || packed->floating)
+            return {};
+        return { packed->integers.data(), packed->integers.size() };
+    }
+
+    inline std::map<std::string, JSON> to_map() const noexcept
+    {
+        if (Type != Class::Object)
+            return make_empty_map();
+        std::map<std::string, JSON> copy{};
+        for (auto const& [key, value] : *Internal.Map.value())
+            copy.emplace_hint(copy.end(), key, value);
+        return copy;
+    }
+
+    // Where this array or object allocates, nullptr for other values
+    inline std::pmr::memory_resource* resource() const noexcept
+    {
+        if (Type == Class::Object)
+            return detail::user_resource(
+                Internal.Map.value()->get_allocator().resource());
+        if (Type == Class::Array)
+            return detail::user_resource(
+                list(false).get_allocator().resource());
+        return nullptr;
+    }
+
+    inline double to_float() const noexcept
+    {
+        if (Type != Class::Floating)
+            return 0.0;
+        if (Internal.String)
+            return std::strtod(Internal.String.value()->c_str(), nullptr);
+        return std::get<double>(Internal.data_);
+    }
+
+    // 0 for integers that do not fit a long, see to_uint and raw_number
+    inline long to_int() const noexcept
+    {
+        long value = 0;
+        return integral(value) ? value : 0;
+    }
+
+    // 0 for negative integers or those that do not fit an unsigned long
+    inline unsigned long to_uint() const noexcept
+    {
+        if (Type != Class::Integral)
+            return 0;
+        if (!Internal.String) {
+            long value = std::get<long>(Internal.data_);
+            return value < 0 ? 0 : static_cast<unsigned long>(value);
+        }
+        unsigned long value = 0;
+        auto const& raw = *Internal.String.value();
+        std::from_chars(raw.data(), raw.data() + raw.size(), value);
+        return value;
+    }
+
+    // number as decimal text, verbatim with Options::lazy_numbers
+    inline std::string raw_number() const
+    {
+        if (Type != Class::Integral && Type != Class::Floating)
+            return "";
+        if (Internal.String)
+            return std::string(*Internal.String.value());
+        if (Type == Class::Integral)
+            return std::to_string(std::get<long>(Internal.data_));
+        char buffer[32];
+        std::snprintf(buffer,
+                      sizeof(buffer),
+                      "%.17g",
+                      std::get<double>(Internal.data_));
+        return buffer;
+    }
+
+    constexpr inline bool to_bool() const noexcept
+    {
+        return Type == Class::Boolean ? std::get<bool>(Internal.data_) : false;
+    }
+
+    inline JSON_Wrapper<detail::JSON_Map> object_range() const noexcept
+    {
+        return JSON_Wrapper<detail::JSON_Map>(Internal.Map.value());
+    }
+
+    inline JSON_Wrapper<detail::JSON_Deque> array_range() const noexcept
+    {
+        // the elements may be written through the range
+        list(true);
+        return JSON_Wrapper<detail::JSON_Deque>(detail::array_nodes(*this));
+    }
+
+    std::string dump(int depth = 1, std::string tab = "  ") const noexcept;
+
+    friend std::ostream& operator<<(std::ostream&, const JSON&);
+
+  private:
+    inline size_t array_size() const noexcept
+    {
+        if (auto const* packed = detail::packed_array(*this))
+            return packed->size();
+        return list(false).size();
+    }
+
+    // The elements as nodes; writing through those of a packed array
+    // leaves its numbers stale, so writers pass writable
+    inline detail::JSON_Deque& list(bool writable) const
+    {
+        auto* slot = std::get_if<detail::Packed_Array_PTR>(&Internal.data_);
+        if (!slot)
+            return *Internal.List.value();
+        auto& nodes = *(*slot)->nodes();
+        if (writable)
+            (*slot)->boxed.store(true, std::memory_order_release);
+        return nodes;
+    }
+
+    // An integral value that fits a long
+    inline bool integral(long& value) const noexcept
+    {
+        if (Type != Class::Integral)
+            return false;
+        if (!Internal.String) {
+            value = std::get<long>(Internal.data_);
+            return true;
+        }
+        auto const& raw = *Internal.String.value();
+        auto [end, status] =
+            std::from_chars(raw.data(), raw.data() + raw.size(), value);
+        return status == std::errc() && end == raw.data() + raw.size();
+    }
+
+    inline void set_type(Class type) const noexcept
+    {
+        if (type == Type)
+            return;
+
+        // reset internal state
+        release();
+        this->Internal = internal();
+
+        switch (type) {
+            case Class::Null:
+                break;
+            case Class::Object:
+                Internal.Map = detail::make_data_object<detail::JSON_Map>();
+                break;
+            case Class::Array:
+                Internal.List = detail::make_data_object<detail::JSON_Deque>();
+                break;
+            case Class::String:
+                Internal.data_ = detail::Short_String{};
+                break;
+            case Class::Floating:
+                Internal.data_ = static_cast<double>(0.0);
+                break;
+            case Class::Integral:
+                Internal.data_ = static_cast<int>(0);
+                break;
+            case Class::Boolean:
+                Internal.data_ = static_cast<bool>(false);
+                break;
+        }
+
+        Type = type;
+    }
+
+    // tear down nested containers iteratively, bounded stack
+    void release() const noexcept
+    {
+        std::vector<JSON> pending{};
+        take_children(*this, pending);
+        while (!pending.empty()) {
+            JSON node = std::move(pending.back());
+            pending.pop_back();
+            take_children(node, pending);
+        }
+    }
+
+    static inline bool is_container(JSON const& node) noexcept
+    {
+        auto* packed =
+            std::get_if<detail::Packed_Array_PTR>(&node.Internal.data_);
+        return (node.Internal.Map && *node.Internal.Map) ||
+               (node.Internal.List && *node.Internal.List) ||
+               (packed && *packed &&
+                (*packed)->boxed.load(std::memory_order_relaxed));
+    }
+
+    static void take_children(JSON const& node,
+                              std::vector<JSON>& pending) noexcept
+    {
+        auto* packed =
+            std::get_if<detail::Packed_Array_PTR>(&node.Internal.data_);
+        if (node.Internal.Map && node.Internal.Map->use_count() == 1) {
+            for (auto& child : **node.Internal.Map)
+                if (is_container(child.second))
+                    pending.emplace_back(std::move(child.second));
+        } else if (node.Internal.List && node.Internal.List->use_count() == 1) {
+            for (auto& child : **node.Internal.List)
+                if (is_container(child))
+                    pending.emplace_back(std::move(child));
+        } else if (packed && packed->use_count() == 1 &&
+                   (*packed)->boxed.load(std::memory_order_relaxed)) {
+            // elements written through nodes may be containers too
+            for (auto& child : *(*packed)->nodes())
+                if (is_container(child))
+                    pending.emplace_back(std::move(child));
+        }
+    }
+
+  private:
+    mutable Class Type = Class::Null;
+};
+
+namespace detail {
+
+inline JSON& member(JSON_Map& map, std::string_view key)
+{
+    auto it = map.lower_bound(key);
+    if (it == map.end() || it->first != key)
+        it = map.emplace_hint(it,
+                              std::piecewise_construct,
+                              std::forward_as_tuple(key),
+                              std::forward_as_tuple());
+    return it->second;
+}
+
+inline JSON Packed_Array::at(size_t index) const
+{
+    return floating ? JSON(doubles[index]) : JSON(integers[index]);
+}
+
+inline JSON_Deque_PTR const& Packed_Array::nodes() const
+{
+    std::call_once(built_, [this] {
+        Resource_Scope scope(doubles.get_allocator().resource());
+        auto list = make_data_object<JSON_Deque>();
+        for (size_t i = 0; i < size(); ++i)
+            list->push_back(at(i));
+        nodes_ = std::move(list);
+    });
+    return nodes_;
+}
+
+inline Packed_Array* packed_array(JSON const& value) noexcept
+{
+    auto* slot = std::get_if<Packed_Array_PTR>(&value.Internal.data_);
+    if (!slot || !*slot || (*slot)->boxed.load(std::memory_order_acquire))
+        return nullptr;
+    return slot->get();
+}
+
+inline JSON_Deque_PTR const& array_nodes(JSON const& value)
+{
+    if (auto* slot = std::get_if<Packed_Array_PTR>(&value.Internal.data_))
+        return (*slot)->nodes();
+    return value.Internal.List.value();
+}
+
+} // namespace detail
+
+inline JSON array() noexcept
+{
+    return JSON::make(JSON::Class::Array);
+}
+
+template<typename... T>
+inline JSON array(T... args) noexcept
+{
+    JSON arr = JSON::make(JSON::Class::Array);
+    arr.append(args...);
+    return arr;
+}
+
+inline JSON object() noexcept
+{
+    return JSON::make(JSON::Class::Object);
+}
+
+// Outcome of JSON::try_load: the document, or null and the reason
+struct Load_Result
+{
+    JSON value{};
+    Parse_Error error{};
+
+    explicit operator bool() const noexcept { return !error; }
+};
+
+///////////////////////
+// Traversal
+//////////////////////
+
+// iterative depth-first traversal, the visitor provides
+// bool enter(JSON const&, std::pmr::string const* key) and
+// void leave(JSON const&); enter() returning false skips children
+template<typename Visitor>
+void walk(JSON const& root, Visitor&& visitor)
+{
+    struct Frame
+    {
+        JSON const* node;
+        detail::JSON_Map::const_iterator member;
+        detail::JSON_Deque::const_iterator element;
+        // elements of a packed array are visited as temporary nodes
+        detail::Packed_Array const* packed;
+        size_t index;
+    };
+    std::vector<Frame> stack{};
+
+    auto visit = [&](JSON const& node, detail::JSON_String const* key) {
+        if (!visitor.enter(node, key))
+            return;
+        if (node.JSON_type() == JSON::Class::Object)
+            stack.push_back(Frame{
+                &node, node.Internal.Map.value()->cbegin(), {}, nullptr, 0 });
+        else if (auto const* packed = detail::packed_array(node))
+            stack.push_back(Frame{ &node, {}, {}, packed, 0 });
+        else if (node.JSON_type() == JSON::Class::Array)
+            stack.push_back(Frame{
+                &node, {}, detail::array_nodes(node)->cbegin(), nullptr, 0 });
+    };
+
+    visit(root, nullptr);
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        JSON const& node = *top.node;
+        if (node.JSON_type() == JSON::Class::Object) {
+            if (top.member != node.Internal.Map.value()->cend()) {
+                auto const& member = *top.member++;
+                visit(member.second, &member.first);
+                continue;
+            }
+        } else if (top.packed) {
+            if (top.index < top.packed->size()) {
+                visit(top.packed->at(top.index++), nullptr);
+                continue;
+            }
+        } else if (top.element != detail::array_nodes(node)->cend()) {
+            visit(*top.element++, nullptr);
+            continue;
+        }
+        stack.pop_back();
+        visitor.leave(node);
+    }
+}
+
+///////////////////////
+// Serialization
+//////////////////////
+
+// event-driven serializer, same layout as JSON::dump()
+class Writer
+{
+  public:
+    explicit Writer(int depth = 1, std::string tab = "  ")
+        : depth_(depth < 0 ? 0 : static_cast<size_t>(depth))
+        , tab_(std::move(tab))
+    {
+    }
+
+    inline void null() { scalar("null"); }
+    inline void boolean(bool b) { scalar(b ? "true" : "false"); }
+    inline void integral(long i)
+    {
+        char buffer[24];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), i).ptr;
+        scalar({ buffer, static_cast<size_t>(end - buffer) });
+    }
+    // formatted as std::to_string, without its temporary
+    inline void floating(double f)
+    {
+        char buffer[DBL_MAX_10_EXP + 20];
+        int length = std::snprintf(buffer, sizeof(buffer), "%f", f);
+        scalar({ buffer, static_cast<size_t>(length) });
+    }
+    // a number in its source form, written verbatim
+    inline void number(std::string_view raw) { scalar(raw); }
+
+    inline void string(std::string_view str)
+    {
+        separate();
+        out_ += '\"';
+        out_ += detail::json_escape(str);
+        out_ += '\"';
+    }
+
+    inline void key(std::string_view key)
+    {
+        auto& level = levels_.back();
+        if (!level.first)
+            out_ += ",\n";
+        level.first = false;
+        pad(levels_.size() - 1, 0);
+        out_ += '\"';
+        out_ += key;
+        out_ += "\" : ";
+    }
+
+    // the element count, when known, is only used by binary writers
+    inline void begin_object(size_t = 0)
+    {
+        separate();
+        out_ += "{\n";
+        levels_.push_back(Level{ true, true });
+    }
+
+    inline void end_object()
+    {
+        out_ += '\n';
+        pad(levels_.size() - 1, 2);
+        out_ += '}';
+        levels_.pop_back();
+    }
+
+    inline void begin_array(size_t = 0)
+    {
+        separate();
+        out_ += '[';
+        levels_.push_back(Level{ false, true });
+    }
+
+    inline void end_array()
+    {
+        out_ += ']';
+        levels_.pop_back();
+    }
+
+    void write(JSON const& value);
+
+    inline std::string const& str() const noexcept { return out_; }
+    inline std::string take() noexcept { return std::move(out_); }
+
+  private:
+    struct Level
+    {
+        bool object;
+        bool first;
+    };
+
+    inline void scalar(std::string_view text)
+    {
+        separate();
+        out_ += text;
+    }
+
+    // array elements are comma separated, object members by key()
+    inline void separate()
+    {
+        if (levels_.empty() || levels_.back().object)
+            return;
+        if (!levels_.back().first)
+            out_ += ", ";
+        levels_.back().first = false;
+    }
+
+    inline void pad(size_t level, size_t trim)
+    {
+        size_t width = (depth_ + level) * tab_.size();
+        while (pad_.size() < width)
+            pad_ += tab_;
+        if (width > trim)
+            out_.append(pad_, trim, width - trim);
+    }
+
+    size_t depth_;
+    std::string tab_;
+    std::string pad_{};
+    std::string out_{};
+    std::vector<Level> levels_{};
+};
+
+namespace detail {
+
+// replay a document as Writer events
+template<typename W>
+void emit(JSON const& root, W& writer, bool decode_keys)
+{
+    struct Visitor
+    {
+        W& writer;
+        bool decode_keys;
+        bool enter(JSON const& value, detail::JSON_String const* key)
+        {
+            if (key) {
+                if (decode_keys && key->find('\\') != key->npos)
+                    writer.key(unquote('\"' + std::string(*key) + '\"'));
+                else
+                    writer.key(*key);
+            }
+            switch (value.JSON_type()) {
+                case JSON::Class::Null:
+                    writer.null();
+                    break;
+                case JSON::Class::Object:
+                    writer.begin_object(value.size());
+                    break;
+                case JSON::Class::Array: {
+                    writer.begin_array(value.size());
+                    // packed numbers go straight from their vector
+                    auto doubles = value.as_doubles();
+                    auto integers = value.as_integers();
+                    if (doubles.empty() && integers.empty())
+                        break;
+                    for (double f : doubles)
+                        writer.floating(f);
+                    for (long i : integers)
+                        writer.integral(i);
+                    writer.end_array();
+                    return false;
+                }
+                case JSON::Class::String:
+                    writer.string(value.text());
+                    break;
+                case JSON::Class::Floating:
+                    if (value.Internal.String)
+                        writer.number(*value.Internal.String.value());
+                    else
+                        writer.floating(value.to_float());
+                    break;
+                case JSON::Class::Integral:
+                    if (value.Internal.String)
+                        writer.number(*value.Internal.String.value());
+                    else
+                        writer.integral(value.to_int());
+                    break;
+                case JSON::Class::Boolean:
+                    writer.boolean(value.to_bool());
+                    break;
+            }
+            return true;
+        }
+        void leave(JSON const& value)
+        {
+            if (value.JSON_type() == JSON::Class::Object)
+                writer.end_object();
+            else
+                writer.end_array();
+        }
+    };
+    walk(root, Visitor{ writer, decode_keys });
+}
+
+} // namespace detail
+
+inline void Writer::write(JSON const& root)
+{
+    detail::emit(root, *this, false);
+}
+
+inline std::string JSON::dump(int depth, std::string tab) const noexcept
+{
+    detail::Stats_Timer timer(detail::stat_dump_ns);
+    detail::Trace_Span span("dump", 0);
+    Writer writer(depth, std::move(tab));
+    writer.write(*this);
+    detail::count(detail::stat_dumps);
+    detail::count(detail::stat_bytes_written, writer.str().size());
+    span.bytes(writer.str().size());
+    return writer.take();
+}
+
+inline JSON Stats::to_json() const
+{
+    static const char* const classes[] = { "null",   "object",   "array",
+                                           "string", "floating", "integral",
+                                           "boolean" };
+    JSON out = json::object();
+    out["enabled"] = enabled;
+    out["loads"] = static_cast<long>(loads);
+    out["dumps"] = static_cast<long>(dumps);
+    out["bytes_read"] = static_cast<long>(bytes_read);
+    out["bytes_written"] = static_cast<long>(bytes_written);
+    JSON& counts = out["nodes"];
+    counts = json::object();
+    for (size_t i = 0; i < nodes.size(); ++i)
+        counts[classes[i]] = static_cast<long>(nodes[i]);
+    out["max_depth"] = static_cast<long>(max_depth);
+    out["strings"] = static_cast<long>(strings);
+    out["escapes"] = static_cast<long>(escapes);
+    out["allocations"] = static_cast<long>(allocations);
+    out["bytes_allocated"] = static_cast<long>(bytes_allocated);
+    // scanning is whatever load spent outside the other phases
+    uint64_t phases = string_ns + number_ns + build_ns;
+    JSON& time = out["time_ns"];
+    time = json::object();
+    time["load"] = static_cast<long>(load_ns);
+    time["read"] = static_cast<long>(read_ns);
+    time["scan"] = static_cast<long>(load_ns > phases ? load_ns - phases : 0);
+    time["strings"] = static_cast<long>(string_ns);
+    time["numbers"] = static_cast<long>(number_ns);
+    time["build"] = static_cast<long>(build_ns);
+    time["dump"] = static_cast<long>(dump_ns);
+    return out;
+}
+
+inline bool JSON::operator==(JSON const& other) const noexcept
+{
+    std::vector<std::pair<JSON const*, JSON const*>> pending{ { this,
+                                                                &other } };
+    while (!pending.empty()) {
+        auto [lhs, rhs] = pending.back();
+        pending.pop_back();
+        if (lhs->Type != rhs->Type)
+            return false;
+        switch (lhs->Type) {
+            case Class::Null:
+                break;
+            case Class::Object: {
+                auto const& a = lhs->Internal.Map.value();
+                auto const& b = rhs->Internal.Map.value();
+                if (a == b)
+                    break;
+                if (a->size() != b->size())
+                    return false;
+                for (auto i = a->cbegin(), j = b->cbegin(); i != a->cend();
+                     ++i, ++j) {
+                    if (i->first != j->first)
+                        return false;
+                    pending.emplace_back(&i->second, &j->second);
+                }
+            } break;
+            case Class::Array: {
+                auto const* x = detail::packed_array(*lhs);
+                auto const* y = detail::packed_array(*rhs);
+                if (x && y && x->floating == y->floating) {
+                    if (x->floating ? x->doubles != y->doubles
+                                    : x->integers != y->integers)
+                        return false;
+                    break;
+                }
+                if (x || y) {
+                    // packed against boxed, element by element
+                    if (lhs->size() != rhs->size())
+                        return false;
+                    for (size_t i = 0; i < lhs->size(); ++i)
+                        if ((x ? x->at(i) : detail::array_nodes(*lhs)->at(i)) !=
+                            (y ? y->at(i) : detail::array_nodes(*rhs)->at(i)))
+                            return false;
+                    break;
+                }
+                auto const& a = detail::array_nodes(*lhs);
+                auto const& b = detail::array_nodes(*rhs);
+                if (a == b)
+                    break;
+                if (a->size() != b->size())
+                    return false;
+                for (size_t i = 0; i < a->size(); ++i)
+                    pending.emplace_back(&(*a)[i], &(*b)[i]);
+            } break;
+            case Class::String:
+                if (lhs->text() != rhs->text())
+                    return false;
+                break;
+            case Class::Floating:
+                if (lhs->to_float() != rhs->to_float())
+                    return false;
+                break;
+            case Class::Integral: {
+                // integers beyond a long only compare by their text
+                long a = 0;
+                long b = 0;
+                bool fits = lhs->integral(a);
+                if (fits != rhs->integral(b) ||
+                    (fits ? a != b
+                          : *lhs->Internal.String.value() !=
+                                *rhs->Internal.String.value()))
+                    return false;
+            } break;
+            case Class::Boolean:
+                if (lhs->Internal.data_ != rhs->Internal.data_)
+                    return false;
+                break;
+        }
+    }
+    return true;
+}
+
+inline size_t JSON::hash() const noexcept
+{
+    struct Visitor
+    {
+        size_t seed = 0;
+        inline void mix(size_t value)
+        {
+            seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+        }
+        bool enter(JSON const& value, detail::JSON_String const* key)
+        {
+            if (key)
+                mix(std::hash<std::string_view>{}(*key));
+            mix(static_cast<size_t>(value.JSON_type()));
+            switch (value.JSON_type()) {
+                case Class::String:
+                    mix(std::hash<std::string_view>{}(value.text()));
+                    break;
+                case Class::Floating:
+                    mix(std::hash<double>{}(value.to_float()));
+                    break;
+                case Class::Integral: {
+                    long integral = 0;
+                    mix(value.integral(integral)
+                            ? std::hash<long>{}(integral)
+                            : std::hash<std::string_view>{}(
+                                  *value.Internal.String.value()));
+                } break;
+                case Class::Boolean:
+                    mix(value.to_bool());
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        }
+        // closes the container so [[1], 2] and [[1, 2]] differ
+        void leave(JSON const&) { mix(0xff); }
+    };
+    Visitor visitor{};
+    walk(*this, visitor);
+    return visitor.seed;
+}
+
+namespace detail {
+template<typename Type>
+Type get_safe_data_object(std::optional<std::shared_ptr<Type>> const& type)
+{
+    if constexpr (std::is_same_v<Type, detail::JSON_Map>) {
+        return type.has_value() ? *type.value() : detail::JSON_Map{};
+    } else if constexpr (std::is_same_v<Type, detail::JSON_Deque>) {
+        return type.has_value() ? *type.value() : detail::JSON_Deque{};
+    } else {
+        return type.has_value() ? *type.value() : Type{};
+    }
+}
+
+// offset of the next '"', '\\' or control byte, SIMD when available
+using Scan_Function = size_t (*)(const char*, size_t, size_t, bool&) noexcept;
+
+inline size_t
+scan_string_scalar(const char* data,
+                   size_t size,
+                   size_t offset,
+                   bool& non_ascii) noexcept
+{
+    unsigned char high = 0;
+    for (; offset < size; ++offset) {
+        auto c = static_cast<unsigned char>(data[offset]);
+        if (c == '\"' || c == '\\' || c < 0x20)
+            break;
+        high |= c;
+    }
+    non_ascii |= (high & 0x80) != 0;
+    return offset;
+}
+
+inline unsigned count_trailing_zeros(uint32_t mask) noexcept
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// the block's first special byte, noting high bits that come before it
+inline size_t scan_string_hit(uint32_t special,
+                              uint32_t high,
+                              size_t offset,
+                              bool& non_ascii) noexcept
+{
+    unsigned index = count_trailing_zeros(special);
+    non_ascii |= (high & ((1u << index) - 1)) != 0;
+    return offset + index;
+}
+
+#if SIMPLEJSON_SSE2
+inline size_t scan_string_sse2(const char* data,
+                               size_t size,
+                               size_t offset,
+                               bool& non_ascii) noexcept
+{
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    for (; offset + 16 <= size; offset += 16) {
+        __m128i block = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + offset));
+        // unsigned block <= 0x1F is min(block, 0x1F) == block
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, quote),
+                         _mm_cmpeq_epi8(block, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(block, control), block));
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(special));
+        auto high = static_cast<uint32_t>(_mm_movemask_epi8(block));
+        if (mask)
+            return scan_string_hit(mask, high, offset, non_ascii);
+        non_ascii |= high != 0;
+    }
+    return scan_string_scalar(data, size, offset, non_ascii);
+}
+#endif
+
+#if SIMPLEJSON_AVX2
+__attribute__((target("avx2"))) inline size_t
+scan_string_avx2(const char* data,
+                 size_t size,
+                 size_t offset,
+                 bool& non_ascii) noexcept
+{
+    const __m256i quote = _mm256_set1_epi8('\"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    for (; offset + 32 <= size; offset += 32) {
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + offset));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quote),
+                            _mm256_cmpeq_epi8(block, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block));
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        auto high = static_cast<uint32_t>(_mm256_movemask_epi8(block));
+        if (mask)
+            return scan_string_hit(mask, high, offset, non_ascii);
+        non_ascii |= high != 0;
+    }
+    return scan_string_sse2(data, size, offset, non_ascii);
+}
+#endif
+
+#if SIMPLEJSON_NEON
+inline size_t scan_string_neon(const char* data,
+                               size_t size,
+                               size_t offset,
+                               bool& non_ascii) noexcept
+{
+    const uint8x16_t quote = vdupq_n_u8('\"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t control = vdupq_n_u8(0x20);
+    for (; offset + 16 <= size; offset += 16) {
+        uint8x16_t block =
+            vld1q_u8(reinterpret_cast<const uint8_t*>(data + offset));
+        uint8x16_t special = vorrq_u8(
+            vorrq_u8(vceqq_u8(block, quote), vceqq_u8(block, backslash)),
+            vcltq_u8(block, control));
+        if (vmaxvq_u8(special) == 0) {
+            non_ascii |= vmaxvq_u8(block) >= 0x80;
+            continue;
+        }
+        return scan_string_scalar(data, offset + 16, offset, non_ascii);
+    }
+    return scan_string_scalar(data, size, offset, non_ascii);
+}
+#endif
+
+inline Scan_Function select_scan_string() noexcept
+{
+#if SIMPLEJSON_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return scan_string_avx2;
+#endif
+#if SIMPLEJSON_SSE2
+    return scan_string_sse2;
+#elif SIMPLEJSON_NEON
+    return scan_string_neon;
+#else
+    return scan_string_scalar;
+#endif
+}
+
+inline size_t scan_string(const char* data,
+                          size_t size,
+                          size_t offset,
+                          bool& non_ascii) noexcept
+{
+    static const Scan_Function scan = select_scan_string();
+    return scan(data, size, offset, non_ascii);
+}
+
+// table-driven UTF-8 automaton, vector lookups first with AVX2 or NEON
+inline constexpr uint8_t utf8_table[] = {
+    // character classes of bytes 0x00..0xff
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3,
+    11, 6, 6, 6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8,
+    // transitions, indexed by state + class
+    0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72, 12, 12, 12, 12, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 0, 12, 12, 12, 12, 12, 0, 12, 0, 12, 12,
+    12, 24, 12, 12, 12, 12, 12, 24, 12, 24, 12, 12, 12, 12, 12, 12, 12, 12,
+    12, 24, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12,
+    12, 12, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12, 12, 36, 12, 12, 12, 12,
+    12, 36, 12, 36, 12, 12, 12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12
+};
+
+// Offset of the first byte of an invalid sequence, npos if data is valid
+inline size_t validate_utf8_scalar(const char* data, size_t size) noexcept
+{
+    uint32_t state = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < size;) {
+        if (state == 0) {
+            start = i;
+            while (i + 8 <= size) {
+                uint64_t word;
+                std::memcpy(&word, data + i, sizeof(word));
+                if (word & 0x8080808080808080ULL)
+                    break;
+                i += 8;
+            }
+            if (i == size)
+                break;
+            start = i;
+        }
+        auto byte = static_cast<unsigned char>(data[i++]);
+        state = utf8_table[256 + state + utf8_table[byte]];
+        if (state == 12)
+            return start;
+    }
+    return state == 0 ? std::string_view::npos : start;
+}
+
+// The vector validators look up each byte pair (previous, current) in three
+// nibble tables; a bit set in all three lookups names an error. Bit 7 marks
+// two continuations in a row, which is an error unless the byte two or
+// three back started a three or four byte sequence
+namespace utf8_error {
+inline constexpr uint8_t too_short = 1 << 0;  // lead not followed by 10xxxxxx
+inline constexpr uint8_t too_long = 1 << 1;   // 10xxxxxx after ASCII
+inline constexpr uint8_t overlong_3 = 1 << 2; // E0 80..9F
+inline constexpr uint8_t too_large = 1 << 3;  // above U+10FFFF
+inline constexpr uint8_t surrogate = 1 << 4;  // ED A0..BF
+inline constexpr uint8_t overlong_2 = 1 << 5; // C0, C1
+inline constexpr uint8_t too_large_1000 = 1 << 6;
+inline constexpr uint8_t overlong_4 = 1 << 6; // F0 80..8F
+inline constexpr uint8_t two_conts = 1 << 7;
+inline constexpr uint8_t carry = too_short | too_long | two_conts;
+} // namespace utf8_error
+
+inline constexpr uint8_t utf8_lookup[3][16] = {
+    // high nibble of the previous byte
+    { utf8_error::too_long, utf8_error::too_long, utf8_error::too_long,
+      utf8_error::too_long, utf8_error::too_long, utf8_error::too_long,
+      utf8_error::too_long, utf8_error::too_long, utf8_error::two_conts,
+      utf8_error::two_conts, utf8_error::two_conts, utf8_error::two_conts,
+      utf8_error::too_short | utf8_error::overlong_2, utf8_error::too_short,
+      utf8_error::too_short | utf8_error::overlong_3 | utf8_error::surrogate,
+      utf8_error::too_short | utf8_error::too_large |
+          utf8_error::too_large_1000 | utf8_error::overlong_4 },
+    // low nibble of the previous byte
+    { utf8_error::carry | utf8_error::overlong_3 | utf8_error::overlong_2 |
+          utf8_error::overlong_4,
+      utf8_error::carry | utf8_error::overlong_2, utf8_error::carry,
+      utf8_error::carry, utf8_error::carry | utf8_error::too_large,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large |
+          utf8_error::too_large_1000 | utf8_error::surrogate,
+      utf8_error::carry | utf8_error::too_large | utf8_error::too_large_1000,
+      utf8_error::carry | utf8_error::too_large |
+          utf8_error::too_large_1000 },
+    // high nibble of the current byte
+    { utf8_error::too_short, utf8_error::too_short, utf8_error::too_short,
+      utf8_error::too_short, utf8_error::too_short, utf8_error::too_short,
+      utf8_error::too_short, utf8_error::too_short,
+      utf8_error::too_long | utf8_error::overlong_2 | utf8_error::two_conts |
+          utf8_error::overlong_3 | utf8_error::too_large_1000 |
+          utf8_error::overlong_4,
+      utf8_error::too_long | utf8_error::overlong_2 | utf8_error::two_conts |
+          utf8_error::overlong_3 | utf8_error::too_large,
+      utf8_error::too_long | utf8_error::overlong_2 | utf8_error::two_conts |
+          utf8_error::surrogate | utf8_error::too_large,
+      utf8_error::too_long | utf8_error::overlong_2 | utf8_error::two_conts |
+          utf8_error::surrogate | utf8_error::too_large,
+      utf8_error::too_short, utf8_error::too_short, utf8_error::too_short,
+      utf8_error::too_short }
+};
+
+// Blocks before offset held no error, so the automaton can restart at the
+// last byte there that does not continue a sequence; errors, sequences cut
+// at the block edge and the tail shorter than a block are all found by it
+inline size_t validate_utf8_from(const char* data,
+                                 size_t size,
+                                 size_t offset) noexcept
+{
+    size_t start = offset;
+    for (size_t back = 1; back <= 3 && back <= offset; ++back) {
+        if ((static_cast<unsigned char>(data[offset - back]) & 0xC0) != 0x80) {
+            start = offset - back;
+            break;
+        }
+    }
+    size_t bad = validate_utf8_scalar(data + start, size - start);
+    return bad == std::string_view::npos ? bad : start + bad;
+}
+
+#if SIMPLEJSON_AVX2
+__attribute__((target("avx2"))) inline size_t
+validate_utf8_avx2(const char* data, size_t size) noexcept
+{
+    // each 128-bit lane shuffles within itself, so both get the table
+    const __m256i previous_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8_lookup[0])));
+    const __m256i previous_low = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8_lookup[1])));
+    const __m256i current_high = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8_lookup[2])));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i third = _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80));
+    const __m256i fourth = _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80));
+    const __m256i top = _mm256_set1_epi8(static_cast<char>(0x80));
+    __m256i previous = _mm256_setzero_si256();
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        __m256i block = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + offset));
+        if (!_mm256_movemask_epi8(_mm256_or_si256(block, previous))) {
+            previous = block;
+            continue;
+        }
+        // the bytes one, two and three back, reaching into previous
+        __m256i carried = _mm256_permute2x128_si256(previous, block, 0x21);
+        __m256i back1 = _mm256_alignr_epi8(block, carried, 15);
+        __m256i back2 = _mm256_alignr_epi8(block, carried, 14);
+        __m256i back3 = _mm256_alignr_epi8(block, carried, 13);
+        __m256i special = _mm256_and_si256(
+            _mm256_and_si256(
+                _mm256_shuffle_epi8(
+                    previous_high,
+                    _mm256_and_si256(_mm256_srli_epi16(back1, 4), nibble)),
+                _mm256_shuffle_epi8(previous_low,
+                                    _mm256_and_si256(back1, nibble))),
+            _mm256_shuffle_epi8(
+                current_high,
+                _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+        __m256i must_continue =
+            _mm256_and_si256(_mm256_or_si256(_mm256_subs_epu8(back2, third),
+                                             _mm256_subs_epu8(back3, fourth)),
+                             top);
+        __m256i error = _mm256_xor_si256(must_continue, special);
+        if (!_mm256_testz_si256(error, error))
+            break;
+        previous = block;
+    }
+    return validate_utf8_from(data, size, offset);
+}
+#endif
+
+#if SIMPLEJSON_NEON
+inline size_t validate_utf8_neon(const char* data, size_t size) noexcept
+{
+    const uint8x16_t previous_high = vld1q_u8(utf8_lookup[0]);
+    const uint8x16_t previous_low = vld1q_u8(utf8_lookup[1]);
+    const uint8x16_t current_high = vld1q_u8(utf8_lookup[2]);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    const uint8x16_t third = vdupq_n_u8(0xE0 - 0x80);
+    const uint8x16_t fourth = vdupq_n_u8(0xF0 - 0x80);
+    const uint8x16_t top = vdupq_n_u8(0x80);
+    uint8x16_t previous = vdupq_n_u8(0);
+    size_t offset = 0;
+    for (; offset + 16 <= size; offset += 16) {
+        uint8x16_t block =
+            vld1q_u8(reinterpret_cast<const uint8_t*>(data + offset));
+        if (vmaxvq_u8(vorrq_u8(block, previous)) < 0x80) {
+            previous = block;
+            continue;
+        }
+        uint8x16_t back1 = vextq_u8(previous, block, 15);
+        uint8x16_t back2 = vextq_u8(previous, block, 14);
+        uint8x16_t back3 = vextq_u8(previous, block, 13);
+        uint8x16_t special = vandq_u8(
+            vandq_u8(vqtbl1q_u8(previous_high, vshrq_n_u8(back1, 4)),
+                     vqtbl1q_u8(previous_low, vandq_u8(back1, nibble))),
+            vqtbl1q_u8(current_high, vshrq_n_u8(block, 4)));
+        uint8x16_t must_continue = vandq_u8(
+            vorrq_u8(vqsubq_u8(back2, third), vqsubq_u8(back3, fourth)), top);
+        if (vmaxvq_u8(veorq_u8(must_continue, special)) != 0)
+            break;
+        previous = block;
+    }
+    return validate_utf8_from(data, size, offset);
+}
+#endif
+
+using Validate_Function = size_t (*)(const char*, size_t) noexcept;
+
+inline Validate_Function select_validate_utf8() noexcept
+{
+#if SIMPLEJSON_AVX2
+    if (__builtin_cpu_supports("avx2"))
+        return validate_utf8_avx2;
+#endif
+#if SIMPLEJSON_NEON
+    return validate_utf8_neon;
+#else
+    return validate_utf8_scalar;
+#endif
+}
+
+// Offset of the first byte of an invalid sequence, npos if data is valid
+inline size_t validate_utf8(const char* data, size_t size) noexcept
+{
+    static const Validate_Function validate = select_validate_utf8();
+    return validate(data, size);
+}
+
+template<typename String>
+inline void append_utf8(String& out, uint32_t code)
+{
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// Four hex digits at data, -1 if any is not a hex digit
+inline long parse_hex4(const char* data) noexcept
+{
+    long code = 0;
+    for (int i = 0; i < 4; ++i) {
+        char c = data[i];
+        code <<= 4;
+        if (c >= '0' && c <= '9')
+            code |= c - '0';
+        else if (c >= 'a' && c <= 'f')
+            code |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            code |= c - 'A' + 10;
+        else
+            return -1;
+    }
+    return code;
+}
+} // namespace detail
+
+namespace detail {
+
+// parser input: a '\0' sentinel at size, readable bytes safe to load
+class Input
+{
+  public:
+    Input(std::string const& text) noexcept
+        : Input(text.data(), text.size(), text.size())
+    {
+    }
+    Input(Padded_String const& text) noexcept
+        : Input(text.data(), text.size(), text.size() + Padded_String::padding)
+    {
+    }
+
+    inline char operator[](size_t offset) const noexcept
+    {
+        return data_[offset];
+    }
+    inline const char* data() const noexcept { return data_; }
+    inline size_t size() const noexcept { return size_; }
+    inline size_t readable() const noexcept { return readable_; }
+
+    inline bool matches(size_t offset, std::string_view word) const noexcept
+    {
+        return offset <= size_ && size_ - offset >= word.size() &&
+               std::memcmp(data_ + offset, word.data(), word.size()) == 0;
+    }
+
+  private:
+    Input(const char* data, size_t size, size_t readable) noexcept
+        : data_(data)
+        , size_(size)
+        , readable_(readable)
+    {
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t readable_;
+};
+
+// a number held as its decimal text, see JSON::raw_number
+inline JSON number_text(std::string_view raw, bool floating)
+{
+    JSON number =
+        JSON::make(floating ? JSON::Class::Floating : JSON::Class::Integral);
+    number.Internal.data_ = std::monostate();
+    number.Internal.String = make_data_object<JSON_String>(raw);
+    return number;
+}
+
+} // namespace detail
+
+namespace {
+
+using detail::Input;
+
+inline void consume_ws(Input const& str, size_t& offset) noexcept
+{
+    while (isspace(str[offset]))
+        ++offset;
+}
+
+// Record the first error and yield the null that parsers return with it
+inline JSON fail(Parse_Error& error,
+                 Parse_Error::Code code,
+                 size_t offset) noexcept
+{
+    error.code = code;
+    error.offset = offset;
+    return JSON();
+}
+
+// Append the decoded contents of the string at offset to val, a string or
+// vector of char; false with the error recorded if it is malformed
+template<typename Buffer>
+bool decode_string(Input const& str,
+                   size_t& offset,
+                   Parse_Error& error,
+                   Buffer& val) noexcept
+{
+    using Code = Parse_Error::Code;
+    auto invalid = [&](Code code, size_t at) {
+        offset = at;
+        fail(error, code, at);
+        return false;
+    };
+    size_t start = offset++;
+    while (true) {
+        // append the run of plain bytes up to the next quote or escape
+        bool non_ascii = false;
+        size_t end =
+            detail::scan_string(str.data(), str.readable(), offset, non_ascii);
+        if (end >= str.size())
+            return invalid(Code::unterminated_string, start);
+        size_t bad = non_ascii ? detail::validate_utf8(str.data() + offset,
+                                                       end - offset)
+                               : std::string_view::npos;
+        if (bad != std::string_view::npos)
+            return invalid(Code::invalid_utf8, offset + bad);
+        val.insert(val.end(), str.data() + offset, str.data() + end);
+        offset = end;
+        if (str[offset] == '\"')
+            break;
+        if (str[offset] != '\\')
+            return invalid(Code::control_character, offset);
+
+        char c = str[++offset];
+        ++offset;
+        detail::count(detail::stat_escapes);
+        switch (c) {
+            case '\"':
+            case '\\':
+            case '/':
+                val.push_back(c);
+                break;
+            case 'b':
+                val.push_back('\b');
+                break;
+            case 'f':
+                val.push_back('\f');
+                break;
+            case 'n':
+                val.push_back('\n');
+                break;
+            case 'r':
+                val.push_back('\r');
+                break;
+            case 't':
+                val.push_back('\t');
+                break;
+            case 'u': {
+                size_t escape = offset - 2;
+                long code = offset + 4 <= str.size()
+                                ? detail::parse_hex4(str.data() + offset)
+                                : -1;
+                if (code < 0)
+                    return invalid(Code::invalid_unicode_escape, offset);
+                offset += 4;
+                if (code >= 0xD800 && code <= 0xDBFF) {
+                    long low = offset + 6 <= str.size() &&
+                                       str[offset] == '\\' &&
+                                       str[offset + 1] == 'u'
+                                   ? detail::parse_hex4(str.data() + offset + 2)
+                                   : -1;
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        return invalid(Code::unpaired_surrogate, escape);
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    offset += 6;
+                } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                    return invalid(Code::unpaired_surrogate, escape);
+                }
+                detail::append_utf8(val, static_cast<uint32_t>(code));
+            } break;
+            default:
+                return invalid(Code::invalid_escape, offset - 2);
+        }
+    }
+    ++offset;
+    return true;
+}
+
+JSON parse_string(Input const& str,
+                  size_t& offset,
+                  Parse_Error& error) noexcept
+{
+    // built where the node will keep it, so it is moved rather than copied
+    detail::JSON_String val{ detail::current_resource() };
+    if (!decode_string(str, offset, error, val))
+        return JSON();
+    return JSON(std::move(val));
+}
+
+JSON parse_number(Input const& str,
+                  size_t& offset,
+                  Parse_Error& error,
+                  bool lazy = false) noexcept
+{
+    auto invalid = [&] {
+        return fail(error, Parse_Error::Code::invalid_number, offset);
+    };
+    auto digits = [&] {
+        size_t begin = offset;
+        while (str[offset] >= '0' && str[offset] <= '9')
+            ++offset;
+        return offset - begin;
+    };
+    size_t begin = offset;
+    bool is_floating = false;
+    if (str[offset] == '-')
+        ++offset;
+    // a leading zero may only be followed by a fraction or an exponent
+    if (str[offset] == '0' && str[offset + 1] >= '0' &&
+        str[offset + 1] <= '9') {
+        ++offset;
+        return invalid();
+    }
+    if (digits() == 0)
+        return invalid();
+    if (str[offset] == '.') {
+        ++offset;
+        if (digits() == 0)
+            return invalid();
+        is_floating = true;
+    }
+    if (str[offset] == 'E' || str[offset] == 'e') {
+        ++offset;
+        if (str[offset] == '-' || str[offset] == '+')
+            ++offset;
+        if (digits() == 0)
+            return invalid();
+        is_floating = true;
+    }
+    char c = str[offset];
+    if (c != '\0' && !isspace(c) && c != ',' && c != ']' && c != '}')
+        return invalid();
+
+    const char* first = str.data() + begin;
+    const char* last = str.data() + offset;
+    JSON Number;
+    long integral = 0;
+    auto [end, status] = std::from_chars(first, last, integral);
+    if (!lazy && is_floating) {
+        Number = std::strtod(first, nullptr);
+    } else if (!lazy && status == std::errc() && end == last) {
+        Number = integral;
+    } else {
+        // integers beyond a long keep their text too, see raw_number
+        Number = detail::number_text(
+            std::string_view(first, static_cast<size_t>(last - first)),
+            is_floating);
+    }
+    return Number;
+}
+JSON parse_bool(Input const& str, size_t& offset, Parse_Error& error) noexcept
+{
+    JSON Bool;
+    if (str.matches(offset, "true"))
+        Bool = true;
+    else if (str.matches(offset, "false"))
+        Bool = false;
+    else
+        return fail(error, Parse_Error::Code::invalid_literal, offset);
+    offset += (Bool.to_bool() ? 4 : 5);
+    return Bool;
+}
+JSON parse_null(Input const& str, size_t& offset, Parse_Error& error) noexcept
+{
+    JSON Null;
+    if (!str.matches(offset, "null"))
+        return fail(error, Parse_Error::Code::invalid_literal, offset);
+    offset += 4;
+    return Null;
+}
+// stats for a value added to the tree
+inline void count_value(JSON const& value) noexcept
+{
+    if constexpr (!Stats::enabled)
+        return;
+    auto type = value.JSON_type();
+    auto node = detail::stat_nodes + static_cast<size_t>(type);
+    detail::count(static_cast<detail::Stat>(node));
+    if (auto const* packed = detail::packed_array(value)) {
+        // and the elements it holds unboxed
+        auto kind = packed->floating ? JSON::Class::Floating
+                                     : JSON::Class::Integral;
+        node = detail::stat_nodes + static_cast<size_t>(kind);
+        detail::count(static_cast<detail::Stat>(node), packed->size());
+    }
+}
+
+// read numeric array elements into packed while they fit
+bool parse_packed(Input const& str,
+                  size_t& offset,
+                  detail::Packed_Array& packed) noexcept
+{
+    Parse_Error error{};
+    while (true) {
+        size_t start = offset;
+        char c = str[offset];
+        if (c != '-' && (c < '0' || c > '9'))
+            return false;
+        JSON number = parse_number(str, offset, error);
+        bool floating = number.JSON_type() == JSON::Class::Floating;
+        if (packed.size() == 0)
+            packed.floating = floating;
+        consume_ws(str, offset);
+        char next = str[offset];
+        // integers beyond a long are kept as text, in a node of their own
+        if (error || floating != packed.floating || number.Internal.String ||
+            (next != ',' && next != ']')) {
+            offset = start;
+            return false;
+        }
+        if (floating)
+            packed.doubles.push_back(number.to_float());
+        else
+            packed.integers.push_back(number.to_int());
+        ++offset;
+        if (next == ']') {
+            packed.doubles.shrink_to_fit();
+            packed.integers.shrink_to_fit();
+            return true;
+        }
+        consume_ws(str, offset);
+    }
+}
+
+// iterative parser, nesting bounded by max_depth
+JSON parse_next(Input const& str,
+                size_t& offset,
+                Parse_Error& error,
+                Options const& options = Options{}) noexcept
+{
+    using Code = Parse_Error::Code;
+    size_t max_depth = options.max_depth;
+    Trace_Sink* tracer = detail::current_trace_sink();
+    struct Frame
+    {
+        JSON container;
+        std::string key;
+        detail::Trace_Mark mark;
+    };
+    std::vector<Frame> stack{};
+    JSON value;
+
+    // at the end of input, or at the unexpected character
+    auto unexpected = [&](Code code) {
+        return fail(
+            error, offset >= str.size() ? Code::unexpected_end : code, offset);
+    };
+    // JSON pointer of the value being parsed; when the key itself failed
+    // that is the object holding it
+    auto failed = [&](bool in_key) {
+        std::string pointer{};
+        for (size_t i = 0; i < stack.size(); ++i) {
+            auto const& container = stack[i].container;
+            pointer += '/';
+            if (container.JSON_type() == JSON::Class::Array) {
+                auto index = container.Internal.List.value()->size();
+                pointer += std::to_string(index);
+                continue;
+            }
+            if (in_key && i + 1 == stack.size()) {
+                pointer.pop_back();
+                break;
+            }
+            for (char c : detail::unquote('"' + stack[i].key + '"')) {
+                if (c == '~' || c == '/')
+                    pointer += c == '~' ? "~0" : "~1";
+                else
+                    pointer += c;
+            }
+        }
+        error.pointer = std::move(pointer);
+        return JSON();
+    };
+
+    auto parse_key = [&](std::string& key) -> bool {
+        consume_ws(str, offset);
+        if (str[offset] != '\"') {
+            unexpected(Code::expected_key);
+            return false;
+        }
+        JSON parsed{};
+        {
+            detail::Stats_Timer timer(detail::stat_string_ns);
+            parsed = parse_string(str, offset, error);
+        }
+        detail::count(detail::stat_strings);
+        if (error)
+            return false;
+        key = parsed.to_string();
+        consume_ws(str, offset);
+        if (str[offset] != ':') {
+            unexpected(Code::expected_colon);
+            return false;
+        }
+        ++offset;
+        return true;
+    };
+
+    while (true) {
+        consume_ws(str, offset);
+        char c = str[offset];
+        switch (c) {
+            case '[':
+            case '{': {
+                if (stack.size() >= max_depth) {
+                    fail(error, Code::max_depth, offset);
+                    return failed(false);
+                }
+                bool is_object = c == '{';
+                auto type = is_object ? JSON::Class::Object
+                                      : JSON::Class::Array;
+                auto mark = detail::trace_mark(tracer, offset);
+                ++offset;
+                consume_ws(str, offset);
+                if (str[offset] == (is_object ? '}' : ']')) {
+                    ++offset;
+                    value = JSON::make(type);
+                    break;
+                }
+                detail::Packed_Array_PTR packed{};
+                char first = str[offset];
+                if (!is_object && options.packed_arrays &&
+                    !options.lazy_numbers &&
+                    (first == '-' || (first >= '0' && first <= '9'))) {
+                    packed = detail::make_data_object<detail::Packed_Array>();
+                    detail::Stats_Timer timer(detail::stat_number_ns);
+                    if (parse_packed(str, offset, *packed)) {
+                        detail::trace_subtree(tracer, mark, offset);
+                        value = JSON(std::move(packed));
+                        break;
+                    }
+                }
+                JSON container = JSON::make(type);
+                if (packed) {
+                    // the numbers before the element that did not fit
+                    for (size_t i = 0; i < packed->size(); ++i) {
+                        JSON element = packed->at(i);
+                        count_value(element);
+                        container.Internal.List.value()->push_back(
+                            std::move(element));
+                    }
+                }
+                stack.push_back(Frame{ std::move(container), {}, mark });
+                detail::count(detail::stat_max_depth, stack.size());
+                if (is_object && !parse_key(stack.back().key))
+                    return failed(true);
+                continue;
+            }
+            case '\"': {
+                detail::Stats_Timer timer(detail::stat_string_ns);
+                value = parse_string(str, offset, error);
+                detail::count(detail::stat_strings);
+            } break;
+            case 't':
+            case 'f':
+                value = parse_bool(str, offset, error);
+                break;
+            case 'n':
+                value = parse_null(str, offset, error);
+                break;
+            default:
+                if ((c <= '9' && c >= '0') || c == '-') {
+                    detail::Stats_Timer timer(detail::stat_number_ns);
+                    value = parse_number(
+                        str, offset, error, options.lazy_numbers);
+                    break;
+                }
+                unexpected(Code::unexpected_character);
+                break;
+        }
+        if (error)
+            return failed(false);
+
+        // attach the completed value to its parent, closing every
+        // container that ends here
+        while (true) {
+            if (stack.empty()) {
+                count_value(value);
+                return value;
+            }
+            auto& top = stack.back();
+            bool is_object = top.container.JSON_type() == JSON::Class::Object;
+            count_value(value);
+            {
+                detail::Stats_Timer timer(detail::stat_build_ns);
+                if (is_object)
+                    detail::member(*top.container.Internal.Map.value(),
+                                   top.key) = std::move(value);
+                else
+                    top.container.Internal.List.value()->emplace_back(
+                        std::move(value));
+            }
+
+            consume_ws(str, offset);
+            if (str[offset] == ',') {
+                ++offset;
+                if (is_object && !parse_key(top.key))
+                    return failed(true);
+                break;
+            } else if (str[offset] == (is_object ? '}' : ']')) {
+                ++offset;
+                detail::trace_subtree(tracer, top.mark, offset);
+                value = std::move(top.container);
+                stack.pop_back();
+            } else {
+                unexpected(Code::expected_comma);
+                return failed(false);
+            }
+        }
+    }
+}
+
+}
+
+///////////////////////
+// Main API functions
+//////////////////////
+
+inline JSON JSON::load(std::string_view str) noexcept
+{
+    return JSON::load(str, Options{});
+}
+
+inline JSON JSON::load(std::string_view str, Options const& options) noexcept
+{
+    Parse_Error error{};
+    return JSON::load(str, error, options);
+}
+
+inline JSON JSON::load(std::string_view str,
+                       Parse_Error& error,
+                       Options const& options) noexcept
+{
+    // a view may end anywhere, so it is copied to get the sentinel
+    return JSON::load(Padded_String(str), error, options);
+}
+
+inline JSON JSON::load(Padded_String const& str,
+                       Options const& options) noexcept
+{
+    Parse_Error error{};
+    return JSON::load(str, error, options);
+}
+
+inline JSON JSON::load(Padded_String const& str,
+                       Parse_Error& error,
+                       Options const& options) noexcept
+{
+    detail::Stats_Timer timer(detail::stat_load_ns);
+    detail::Trace_Span span("parse", str.size());
+    detail::Load_Scope scope(options);
+    size_t offset = 0;
+    error = Parse_Error{};
+    JSON value = parse_next(str, offset, error, options);
+    if (!error) {
+        consume_ws(str, offset);
+        if (offset != str.size())
+            fail(error, Parse_Error::Code::trailing_content, offset);
+    }
+    detail::count(detail::stat_loads);
+    detail::count(detail::stat_bytes_read, offset);
+    span.bytes(offset);
+    if (!error)
+        return value;
+    error.locate(str.view());
+    return JSON();
+}
+
+inline Load_Result JSON::try_load(std::string_view str,
+                                  Options const& options) noexcept
+{
+    Load_Result result{};
+    result.value = JSON::load(str, result.error, options);
+    return result;
+}
+
+inline JSON JSON::load_file(std::string_view path)
+{
+    return JSON::load_file(path, Options{});
+}
+
+inline JSON JSON::load_file(std::string_view path, Options const& options)
+{
+    namespace fs = std::filesystem;
+    std::ifstream f(path.data(), std::ios::in | std::ios::binary);
+    const auto sz = fs::file_size(path);
+    detail::Trace_Span span("load_file", sz);
+    Padded_String result(static_cast<size_t>(sz));
+    {
+        detail::Stats_Timer timer(detail::stat_read_ns);
+        detail::Trace_Span read("read", sz);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wsign-conversion"
+        f.read(result.data(), sz);
+#pragma GCC diagnostic pop
+    }
+
+    return JSON::load(result, options);
+}
+
+///////////////////////
+// Streaming tokenizer
+//////////////////////
+
+namespace detail {
+
+inline constexpr bool is_ws(char c) noexcept
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+inline constexpr bool is_delimiter(char c) noexcept
+{
+    return is_ws(c) || c == ',' || c == ']' || c == '}' || c == ':';
+}
+
+inline size_t skip_ws(const char* data, size_t size, size_t offset) noexcept
+{
+    while (offset < size && is_ws(data[offset]))
+        ++offset;
+    return offset;
+}
+
+// offset past the closing quote, npos if unterminated
+inline size_t skip_string(const char* data, size_t size, size_t offset) noexcept
+{
+    bool non_ascii = false;
+    for (++offset;; ++offset) {
+        offset = scan_string(data, size, offset, non_ascii);
+        if (offset >= size)
+            return std::string_view::npos;
+        if (data[offset] == '\"')
+            return offset + 1;
+        if (data[offset] == '\\')
+            ++offset;
+    }
+}
+
+// offset past the value at offset, npos if the input ends first
+inline size_t skip_value(const char* data, size_t size, size_t offset) noexcept
+{
+    offset = skip_ws(data, size, offset);
+    if (offset >= size)
+        return std::string_view::npos;
+    switch (data[offset]) {
+        case '\"':
+            return skip_string(data, size, offset);
+        case '{':
+        case '[':
+            break;
+        default:
+            while (offset < size && !is_delimiter(data[offset]))
+                ++offset;
+            return offset;
+    }
+    size_t depth = 0;
+    for (; offset < size; ++offset) {
+        switch (data[offset]) {
+            case '\"':
+                offset = skip_string(data, size, offset);
+                if (offset == std::string_view::npos)
+                    return offset;
+                --offset;
+                break;
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0)
+                    return offset + 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// pull tokenizer, yields events without building nodes
+class Tokenizer
+{
+  public:
+    using Code = Parse_Error::Code;
+
+    enum class Token
+    {
+        Begin_Object,
+        End_Object,
+        Begin_Array,
+        End_Array,
+        Key,
+        String,
+        Number,
+        Boolean,
+        Null,
+        End,
+        Error
+    };
+
+    explicit Tokenizer(std::string_view input) noexcept
+        : data_(input.data())
+        , size_(input.size())
+    {
+    }
+
+    Token next() noexcept
+    {
+        offset_ = skip_ws(data_, size_, offset_);
+        switch (state_) {
+            case State::Value:
+                return scan_value();
+            case State::Object_Key_Or_End:
+                if (offset_ < size_ && data_[offset_] == '}')
+                    return close('}', Token::End_Object);
+                [[fallthrough]];
+            case State::Object_Key:
+                return scan_key();
+            case State::Array_Value_Or_End:
+                if (offset_ < size_ && data_[offset_] == ']')
+                    return close(']', Token::End_Array);
+                return scan_value();
+            case State::After_Value:
+                if (stack_.empty()) {
+                    state_ = State::Done;
+                    start_ = end_ = offset_;
+                    return Token::End;
+                }
+                if (offset_ >= size_)
+                    return fail(Code::unexpected_end);
+                switch (data_[offset_]) {
+                    case ',':
+                        ++offset_;
+                        state_ = stack_.back() == '{' ? State::Object_Key
+                                                      : State::Value;
+                        return next();
+                    case '}':
+                        return close('}', Token::End_Object);
+                    case ']':
+                        return close(']', Token::End_Array);
+                    default:
+                        return fail(Code::expected_comma);
+                }
+            case State::Done:
+                return Token::End;
+            case State::Failed:
+                break;
+        }
+        return Token::Error;
+    }
+
+    // Start over on new input, keeping the stack's capacity
+    inline void reset(std::string_view input) noexcept
+    {
+        data_ = input.data();
+        size_ = input.size();
+        offset_ = start_ = end_ = 0;
+        state_ = State::Value;
+        stack_.clear();
+        error_ = Code::none;
+    }
+
+    // Skip the rest of the container opened by the last token
+    inline bool skip() noexcept
+    {
+        return skip_to(skip_value(data_, size_, start_));
+    }
+
+    // Resume after a container whose end is already known
+    inline bool skip_to(size_t end) noexcept
+    {
+        if (end == std::string_view::npos || stack_.empty()) {
+            fail(Code::unexpected_end);
+            return false;
+        }
+        stack_.pop_back();
+        start_ = end - 1;
+        end_ = offset_ = end;
+        state_ = State::After_Value;
+        return true;
+    }
+
+    inline std::string_view raw() const noexcept
+    {
+        return std::string_view(data_ + start_, end_ - start_);
+    }
+
+    constexpr inline size_t begin_offset() const noexcept { return start_; }
+    constexpr inline size_t end_offset() const noexcept { return end_; }
+    constexpr inline size_t offset() const noexcept { return offset_; }
+    inline size_t depth() const noexcept { return stack_.size(); }
+    // the reason next() returned Token::Error, nullptr before that
+    inline const char* error() const noexcept
+    {
+        if (error_ == Code::none)
+            return nullptr;
+        return Parse_Error{ error_ }.message().data();
+    }
+    constexpr inline Code error_code() const noexcept { return error_; }
+
+  private:
+    enum class State
+    {
+        Value,
+        Object_Key_Or_End,
+        Object_Key,
+        Array_Value_Or_End,
+        After_Value,
+        Done,
+        Failed
+    };
+
+    inline Token fail(Code code) noexcept
+    {
+        error_ = code;
+        start_ = end_ = offset_;
+        state_ = State::Failed;
+        return Token::Error;
+    }
+
+    inline Token close(char bracket, Token token) noexcept
+    {
+        if (stack_.empty() || stack_.back() != (bracket == '}' ? '{' : '['))
+            return fail(Code::unexpected_character);
+        stack_.pop_back();
+        start_ = offset_++;
+        end_ = offset_;
+        state_ = State::After_Value;
+        return token;
+    }
+
+    inline Token scan_literal(std::string_view literal, Token token) noexcept
+    {
+        if (std::string_view(data_ + offset_, size_ - offset_)
+                .substr(0, literal.size()) != literal)
+            return fail(Code::invalid_literal);
+        offset_ += literal.size();
+        return scalar(token);
+    }
+
+    inline Token scalar(Token token) noexcept
+    {
+        if (offset_ < size_ && !is_delimiter(data_[offset_]))
+            return fail(Code::unexpected_character);
+        end_ = offset_;
+        state_ = State::After_Value;
+        return token;
+    }
+
+    inline size_t scan_digits() noexcept
+    {
+        size_t begin = offset_;
+        while (offset_ < size_ && data_[offset_] >= '0' &&
+               data_[offset_] <= '9')
+            ++offset_;
+        return offset_ - begin;
+    }
+
+    Token scan_number() noexcept
+    {
+        if (data_[offset_] == '-')
+            ++offset_;
+        if (size_ - offset_ > 1 && data_[offset_] == '0' &&
+            data_[offset_ + 1] >= '0' && data_[offset_ + 1] <= '9') {
+            ++offset_;
+            return fail(Code::invalid_number);
+        }
+        if (scan_digits() == 0)
+            return fail(Code::invalid_number);
+        if (offset_ < size_ && data_[offset_] == '.') {
+            ++offset_;
+            if (scan_digits() == 0)
+                return fail(Code::invalid_number);
+        }
+        if (offset_ < size_ &&
+            (data_[offset_] == 'e' || data_[offset_] == 'E')) {
+            ++offset_;
+            if (offset_ < size_ &&
+                (data_[offset_] == '+' || data_[offset_] == '-'))
+                ++offset_;
+            if (scan_digits() == 0)
+                return fail(Code::invalid_number);
+        }
+        return scalar(Token::Number);
+    }
+
+    Token scan_value() noexcept
+    {
+        if (offset_ >= size_)
+            return fail(Code::unexpected_end);
+        start_ = offset_;
+        switch (data_[offset_]) {
+            case '{':
+                return open('{', State::Object_Key_Or_End, Token::Begin_Object);
+            case '[':
+                return open('[', State::Array_Value_Or_End, Token::Begin_Array);
+            case '\"':
+                offset_ = skip_string(data_, size_, offset_);
+                if (offset_ == std::string_view::npos) {
+                    offset_ = size_;
+                    return fail(Code::unterminated_string);
+                }
+                return scalar(Token::String);
+            case 't':
+                return scan_literal("true", Token::Boolean);
+            case 'f':
+                return scan_literal("false", Token::Boolean);
+            case 'n':
+                return scan_literal("null", Token::Null);
+            default:
+                if (data_[offset_] == '-' ||
+                    (data_[offset_] >= '0' && data_[offset_] <= '9'))
+                    return scan_number();
+        }
+        return fail(Code::unexpected_character);
+    }
+
+    Token scan_key() noexcept
+    {
+        if (offset_ >= size_ || data_[offset_] != '\"')
+            return fail(Code::expected_key);
+        start_ = offset_;
+        end_ = offset_ = skip_string(data_, size_, offset_);
+        if (offset_ == std::string_view::npos) {
+            offset_ = size_;
+            return fail(Code::unterminated_string);
+        }
+        offset_ = skip_ws(data_, size_, offset_);
+        if (offset_ >= size_ || data_[offset_] != ':')
+            return fail(Code::expected_colon);
+        ++offset_;
+        state_ = State::Value;
+        return Token::Key;
+    }
+
+    inline Token open(char bracket, State state, Token token) noexcept
+    {
+        stack_.push_back(bracket);
+        end_ = ++offset_;
+        state_ = state;
+        return token;
+    }
+
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    size_t start_ = 0;
+    size_t end_ = 0;
+    State state_ = State::Value;
+    std::vector<char> stack_{};
+    Code error_ = Code::none;
+};
+
+// Decode the contents of a quoted string token
+inline std::string unquote(std::string_view raw)
+{
+    std::string_view body = raw.substr(1, raw.size() - 2);
+    if (body.find('\\') == std::string_view::npos)
+        return std::string(body);
+    std::string quoted(raw);
+    size_t offset = 0;
+    Parse_Error error{};
+    JSON decoded = parse_string(quoted, offset, error);
+    return std::string(decoded.text());
+}
+
+// Compare a quoted key token against a plain key without decoding it
+inline bool key_equals(std::string_view raw, std::string_view key)
+{
+    std::string_view body = raw.substr(1, raw.size() - 2);
+    if (body.find('\\') == std::string_view::npos)
+        return body == key;
+    return unquote(raw) == key;
+}
+
+} // namespace detail
+
+///////////////////////
+// Projection
+//////////////////////
+
+// dotted field paths to keep while parsing, e.g. "items[*].price"
+class Projection
+{
+  public:
+    Projection(std::initializer_list<std::string_view> paths)
+    {
+        for (auto path : paths)
+            add(path);
+    }
+
+    explicit Projection(std::vector<std::string> const& paths)
+    {
+        for (auto const& path : paths)
+            add(path);
+    }
+
+    void add(std::string_view path)
+    {
+        Node* node = &root_;
+        while (true) {
+            size_t dot = path.find('.');
+            std::string_view segment = path.substr(0, dot);
+            std::string_view name = segment.substr(0, segment.find('['));
+            segment.remove_prefix(name.size());
+            if (!name.empty())
+                node = &field(*node, name);
+            while (segment.substr(0, 3) == "[*]") {
+                if (node->elements.empty())
+                    node->elements.emplace_back();
+                node = &node->elements.front();
+                segment.remove_prefix(3);
+            }
+            if (dot == std::string_view::npos)
+                break;
+            path.remove_prefix(dot + 1);
+        }
+        node->leaf = true;
+    }
+
+  private:
+    friend class JSON;
+
+    struct Node
+    {
+        std::string key{};
+        bool leaf = false;
+        std::vector<Node> fields{};
+        // holds the element node of "[*]", if any
+        std::vector<Node> elements{};
+    };
+
+    static inline Node& field(Node& node, std::string_view key)
+    {
+        for (auto& child : node.fields)
+            if (child.key == key)
+                return child;
+        node.fields.emplace_back();
+        node.fields.back().key = std::string(key);
+        return node.fields.back();
+    }
+
+    static std::optional<JSON> project(detail::Tokenizer& tokenizer,
+                                       std::string const& buffer,
+                                       Node const& node,
+                                       detail::Tokenizer::Token token,
+                                       Parse_Error& error);
+
+    Node root_{};
+};
+
+inline std::optional<JSON> Projection::project(detail::Tokenizer& tokenizer,
+                                               std::string const& buffer,
+                                               Node const& node,
+                                               detail::Tokenizer::Token token,
+                                               Parse_Error& error)
+{
+    using Token = detail::Tokenizer::Token;
+    bool container =
+        token == Token::Begin_Object || token == Token::Begin_Array;
+    if (token == Token::Error)
+        return std::nullopt;
+
+    if (node.leaf) {
+        size_t offset = tokenizer.begin_offset();
+        JSON value = parse_next(buffer, offset, error);
+        if (error || (container && !tokenizer.skip_to(offset)))
+            return std::nullopt;
+        return value;
+    }
+
+    if (token == Token::Begin_Object && !node.fields.empty()) {
+        JSON obj = JSON::make(JSON::Class::Object);
+        for (token = tokenizer.next(); token == Token::Key;
+             token = tokenizer.next()) {
+            auto key = tokenizer.raw();
+            auto field = std::find_if(
+                node.fields.begin(), node.fields.end(), [&](auto& child) {
+                    return detail::key_equals(key, child.key);
+                });
+            auto value = tokenizer.next();
+            if (field != node.fields.end()) {
+                if (auto result =
+                        project(tokenizer, buffer, *field, value, error))
+                    // keys are held escaped, as JSON::load stores them
+                    obj[detail::json_escape(field->key)] = *result;
+            } else if ((value == Token::Begin_Object ||
+                        value == Token::Begin_Array) &&
+                       !tokenizer.skip()) {
+                return std::nullopt;
+            }
+            if (error)
+                return std::nullopt;
+        }
+        if (token != Token::End_Object)
+            return std::nullopt;
+        return obj;
+    }
+
+    if (token == Token::Begin_Array && !node.elements.empty()) {
+        JSON arr = JSON::make(JSON::Class::Array);
+        for (token = tokenizer.next();
+             token != Token::End_Array && token != Token::Error;
+             token = tokenizer.next()) {
+            if (auto result = project(
+                    tokenizer, buffer, node.elements.front(), token, error))
+                arr.append(*result);
+            else if (error)
+                return std::nullopt;
+        }
+        if (token != Token::End_Array)
+            return std::nullopt;
+        return arr;
+    }
+
+    if (container)
+        tokenizer.skip();
+    return std::nullopt;
+}
+
+inline JSON JSON::load(std::string_view str,
+                       Projection const& projection) noexcept
+{
+    Parse_Error error{};
+    return JSON::load(str, projection, error);
+}
+
+inline JSON JSON::load(std::string_view str,
+                       Projection const& projection,
+                       Parse_Error& error) noexcept
+{
+    using Token = detail::Tokenizer::Token;
+    std::string buffer(str);
+    detail::Tokenizer tokenizer(buffer);
+    error = Parse_Error{};
+    auto result = Projection::project(
+        tokenizer, buffer, projection.root_, tokenizer.next(), error);
+    if (!error && tokenizer.next() == Token::End &&
+        tokenizer.offset() != buffer.size())
+        fail(error, Parse_Error::Code::trailing_content, tokenizer.offset());
+    if (!error && tokenizer.error())
+        fail(error, tokenizer.error_code(), tokenizer.begin_offset());
+    if (!error)
+        return result.value_or(JSON());
+    // a pointer from a projected leaf would be relative to that leaf
+    error.pointer.clear();
+    error.locate(buffer);
+    return JSON();
+}
+
+///////////////////////
+// JSONPath
+//////////////////////
+
+// compiled JSONPath query (RFC 9535 subset) run over the tokenizer
+class Path
+{
+  public:
+    static std::optional<Path> compile(std::string_view expression);
+
+    template<typename F>
+    bool for_each(std::string_view input, F&& callback) const;
+
+    std::vector<JSON> query(std::string_view input) const
+    {
+        std::vector<JSON> matches{};
+        for_each(input, [&](std::string_view match) {
+            matches.emplace_back(JSON::load(std::string(match)));
+        });
+        return matches;
+    }
+
+    std::vector<std::pair<size_t, size_t>> query_ranges(
+        std::string_view input) const
+    {
+        std::vector<std::pair<size_t, size_t>> ranges{};
+        for_each(input, [&](std::string_view match) {
+            auto begin = static_cast<size_t>(match.data() - input.data());
+            ranges.emplace_back(begin, begin + match.size());
+        });
+        return ranges;
+    }
+
+  private:
+    struct Filter
+    {
+        enum class Operator
+        {
+            Exists,
+            Equal,
+            Not_Equal,
+            Less,
+            Less_Equal,
+            Greater,
+            Greater_Equal
+        };
+        std::vector<std::string> keys{};
+        Operator op = Operator::Exists;
+        JSON literal{};
+    };
+
+    struct Step
+    {
+        enum class Kind
+        {
+            Name,
+            Wildcard,
+            Index,
+            Slice,
+            Filter
+        };
+        Kind kind = Kind::Wildcard;
+        bool recursive = false;
+        std::string name{};
+        long index = 0;
+        std::optional<long> start{};
+        std::optional<long> end{};
+        long step = 1;
+        Filter filter{};
+    };
+
+    struct Frame
+    {
+        uint64_t states;
+        bool array;
+        size_t index;
+        size_t length;
+    };
+
+    inline bool needs_length(uint64_t states) const noexcept
+    {
+        for (size_t i = 0; i < steps_.size(); ++i) {
+            if (!(states & (1ULL << i)))
+                continue;
+            auto const& step = steps_[i];
+            if ((step.kind == Step::Kind::Index && step.index < 0) ||
+                (step.kind == Step::Kind::Slice &&
+                 (step.start.value_or(0) < 0 || step.end.value_or(0) < 0)))
+                return true;
+        }
+        return false;
+    }
+
+    static bool matches(Step const& step,
+                        std::optional<std::string> const& key,
+                        size_t index,
+                        size_t length,
+                        std::string_view value);
+
+    static bool test(Filter const& filter, std::string_view value);
+
+    std::vector<Step> steps_{};
+};
+
+namespace detail {
+
+inline size_t count_elements(const char* data, size_t size, size_t offset)
+{
+    size_t count = 0;
+    offset = skip_ws(data, size, offset + 1);
+    if (offset < size && data[offset] == ']')
+        return 0;
+    while (offset < size) {
+        offset = skip_value(data, size, offset);
+        if (offset == std::string_view::npos)
+            break;
+        ++count;
+        offset = skip_ws(data, size, offset);
+        if (offset >= size || data[offset] != ',')
+            break;
+        ++offset;
+    }
+    return count;
+}
+
+inline std::optional<long> parse_path_integer(std::string_view& expr)
+{
+    size_t i = expr.size() && expr[0] == '-' ? 1 : 0;
+    size_t begin = i;
+    while (i < expr.size() && expr[i] >= '0' && expr[i] <= '9')
+        ++i;
+    if (i == begin)
+        return std::nullopt;
+    // indices that do not fit a long make the expression invalid
+    long value = 0;
+    auto [end, status] = std::from_chars(expr.data(), expr.data() + i, value);
+    if (status != std::errc() || end != expr.data() + i)
+        return std::nullopt;
+    expr.remove_prefix(i);
+    return value;
+}
+
+inline std::optional<std::string> parse_path_quoted(std::string_view& expr)
+{
+    if (expr.empty() || (expr[0] != '\'' && expr[0] != '\"'))
+        return std::nullopt;
+    char quote = expr[0];
+    std::string value;
+    size_t i = 1;
+    for (; i < expr.size() && expr[i] != quote; ++i) {
+        if (expr[i] == '\\' && i + 1 < expr.size())
+            ++i;
+        value += expr[i];
+    }
+    if (i >= expr.size())
+        return std::nullopt;
+    expr.remove_prefix(i + 1);
+    return value;
+}
+
+inline std::string parse_path_name(std::string_view& expr)
+{
+    size_t i = 0;
+    while (i < expr.size() && expr[i] != '.' && expr[i] != '[' &&
+           expr[i] != ')' && expr[i] != ' ' && expr[i] != '=' &&
+           expr[i] != '!' && expr[i] != '<' && expr[i] != '>')
+        ++i;
+    std::string name(expr.substr(0, i));
+    expr.remove_prefix(i);
+    return name;
+}
+
+inline void trim_path(std::string_view& expr)
+{
+    while (!expr.empty() && expr[0] == ' ')
+        expr.remove_prefix(1);
+}
+
+} // namespace detail
+
+inline std::optional<Path> Path::compile(std::string_view expr)
+{
+    Path path;
+    detail::trim_path(expr);
+    if (expr.empty() || expr[0] != '$')
+        return std::nullopt;
+    expr.remove_prefix(1);
+
+    while (!expr.empty()) {
+        Step step;
+        if (expr.substr(0, 2) == "..") {
+            step.recursive = true;
+            expr.remove_prefix(2);
+            if (expr.empty())
+                return std::nullopt;
+        } else if (expr[0] == '.') {
+            expr.remove_prefix(1);
+        } else if (expr[0] != '[') {
+            return std::nullopt;
+        }
+
+        if (expr.empty())
+            return std::nullopt;
+        if (expr[0] == '*') {
+            expr.remove_prefix(1);
+        } else if (expr[0] != '[') {
+            step.kind = Step::Kind::Name;
+            step.name = detail::parse_path_name(expr);
+            if (step.name.empty())
+                return std::nullopt;
+        } else {
+            expr.remove_prefix(1);
+            detail::trim_path(expr);
+            if (expr.empty())
+                return std::nullopt;
+            if (expr[0] == '*') {
+                expr.remove_prefix(1);
+            } else if (auto name = detail::parse_path_quoted(expr)) {
+                step.kind = Step::Kind::Name;
+                step.name = *name;
+            } else if (expr[0] == '?') {
+                step.kind = Step::Kind::Filter;
+                expr.remove_prefix(1);
+                detail::trim_path(expr);
+                bool parens = !expr.empty() && expr[0] == '(';
+                if (parens)
+                    expr.remove_prefix(1);
+                detail::trim_path(expr);
+                if (expr.empty() || expr[0] != '@')
+                    return std::nullopt;
+                expr.remove_prefix(1);
+                while (!expr.empty() && (expr[0] == '.' || expr[0] == '[')) {
+                    if (expr[0] == '.') {
+                        expr.remove_prefix(1);
+                        step.filter.keys.emplace_back(
+                            detail::parse_path_name(expr));
+                    } else {
+                        expr.remove_prefix(1);
+                        auto key = detail::parse_path_quoted(expr);
+                        if (!key || expr.empty() || expr[0] != ']')
+                            return std::nullopt;
+                        expr.remove_prefix(1);
+                        step.filter.keys.emplace_back(*key);
+                    }
+                }
+                detail::trim_path(expr);
+                using Operator = Filter::Operator;
+                static const std::pair<std::string_view, Operator>
+                    operators[] = { { "==", Operator::Equal },
+                                    { "!=", Operator::Not_Equal },
+                                    { "<=", Operator::Less_Equal },
+                                    { ">=", Operator::Greater_Equal },
+                                    { "<", Operator::Less },
+                                    { ">", Operator::Greater } };
+                for (auto const& [token, op] : operators) {
+                    if (expr.substr(0, token.size()) == token) {
+                        step.filter.op = op;
+                        expr.remove_prefix(token.size());
+                        break;
+                    }
+                }
+                if (step.filter.op != Operator::Exists) {
+                    detail::trim_path(expr);
+                    if (auto str = detail::parse_path_quoted(expr)) {
+                        step.filter.literal = JSON(*str);
+                    } else {
+                        size_t i = 0;
+                        while (i < expr.size() && expr[i] != ')' &&
+                               expr[i] != ']' && expr[i] != ' ')
+                            ++i;
+                        std::string literal(expr.substr(0, i));
+                        detail::Tokenizer tokenizer(literal);
+                        auto token = tokenizer.next();
+                        if (token != detail::Tokenizer::Token::Number &&
+                            token != detail::Tokenizer::Token::Boolean &&
+                            token != detail::Tokenizer::Token::Null)
+                            return std::nullopt;
+                        step.filter.literal = JSON::load(literal);
+                        expr.remove_prefix(i);
+                    }
+                }
+                detail::trim_path(expr);
+                if (parens) {
+                    if (expr.empty() || expr[0] != ')')
+                        return std::nullopt;
+                    expr.remove_prefix(1);
+                }
+            } else {
+                auto first = detail::parse_path_integer(expr);
+                detail::trim_path(expr);
+                if (!expr.empty() && expr[0] == ':') {
+                    step.kind = Step::Kind::Slice;
+                    step.start = first;
+                    expr.remove_prefix(1);
+                    detail::trim_path(expr);
+                    step.end = detail::parse_path_integer(expr);
+                    detail::trim_path(expr);
+                    if (!expr.empty() && expr[0] == ':') {
+                        expr.remove_prefix(1);
+                        detail::trim_path(expr);
+                        // reversed slices cannot be produced in stream order
+                        auto stride = detail::parse_path_integer(expr);
+                        if (stride && *stride <= 0)
+                            return std::nullopt;
+                        step.step = stride.value_or(1);
+                    }
+                } else if (first) {
+                    step.kind = Step::Kind::Index;
+                    step.index = *first;
+                } else {
+                    return std::nullopt;
+                }
+            }
+            detail::trim_path(expr);
+            if (expr.empty() || expr[0] != ']')
+                return std::nullopt;
+            expr.remove_prefix(1);
+        }
+        path.steps_.emplace_back(std::move(step));
+        // one bit per step in the automaton state set, plus accept
+        if (path.steps_.size() > 63)
+            return std::nullopt;
+    }
+    return path;
+}
+
+inline bool Path::matches(Step const& step,
+                          std::optional<std::string> const& key,
+                          size_t index,
+                          size_t length,
+                          std::string_view value)
+{
+    switch (step.kind) {
+        case Step::Kind::Name:
+            return key && *key == step.name;
+        case Step::Kind::Wildcard:
+            return true;
+        case Step::Kind::Index:
+            if (key)
+                return false;
+            if (step.index < 0)
+                return static_cast<long>(length) + step.index ==
+                       static_cast<long>(index);
+            return static_cast<size_t>(step.index) == index;
+        case Step::Kind::Slice: {
+            if (key)
+                return false;
+            auto len = static_cast<long>(length);
+            auto normalize = [len](long i) {
+                return std::clamp(i < 0 ? len + i : i, 0L, len);
+            };
+            long begin = step.start ? normalize(*step.start) : 0;
+            long at = static_cast<long>(index);
+            if (at < begin || (at - begin) % step.step != 0)
+                return false;
+            if (!step.end)
+                return true;
+            return at < (*step.end < 0 ? normalize(*step.end) : *step.end);
+        }
+        case Step::Kind::Filter:
+            return test(step.filter, value);
+    }
+    return false;
+}
+
+inline bool Path::test(Filter const& filter, std::string_view value)
+{
+    using Token = detail::Tokenizer::Token;
+    for (auto const& key : filter.keys) {
+        detail::Tokenizer tokenizer(value);
+        if (tokenizer.next() != Token::Begin_Object)
+            return false;
+        bool found = false;
+        for (auto token = tokenizer.next(); token == Token::Key;
+             token = tokenizer.next()) {
+            bool match = detail::unquote(tokenizer.raw()) == key;
+            auto child = tokenizer.next();
+            if (match) {
+                size_t begin = tokenizer.begin_offset();
+                value = value.substr(
+                    begin,
+                    (child == Token::Begin_Object ||
+                             child == Token::Begin_Array
+                         ? detail::skip_value(value.data(), value.size(), begin)
+                         : tokenizer.end_offset()) -
+                        begin);
+                found = true;
+                break;
+            }
+            if ((child == Token::Begin_Object || child == Token::Begin_Array) &&
+                !tokenizer.skip())
+                return false;
+        }
+        if (!found)
+            return false;
+    }
+
+    using Operator = Filter::Operator;
+    if (filter.op == Operator::Exists)
+        return true;
+
+    JSON lhs = JSON::load(std::string(value));
+    auto const& rhs = filter.literal;
+    auto numeric = [](JSON const& n) {
+        return n.JSON_type() == JSON::Class::Integral ||
+               n.JSON_type() == JSON::Class::Floating;
+    };
+    auto number = [](JSON const& n) {
+        return n.JSON_type() == JSON::Class::Integral
+                   ? static_cast<double>(n.to_int())
+                   : n.to_float();
+    };
+    int order = 0;
+    if (numeric(lhs) && numeric(rhs)) {
+        double a = number(lhs), b = number(rhs);
+        order = a < b ? -1 : (a > b ? 1 : 0);
+    } else if (lhs.JSON_type() == JSON::Class::String &&
+               rhs.JSON_type() == JSON::Class::String) {
+        order = lhs.to_string().compare(rhs.to_string());
+    } else {
+        bool equal = lhs.JSON_type() == rhs.JSON_type() && lhs == rhs;
+        return (filter.op == Operator::Equal && equal) ||
+               (filter.op == Operator::Not_Equal && !equal);
+    }
+    switch (filter.op) {
+        case Operator::Equal:
+            return order == 0;
+        case Operator::Not_Equal:
+            return order != 0;
+        case Operator::Less:
+            return order < 0;
+        case Operator::Less_Equal:
+            return order <= 0;
+        case Operator::Greater:
+            return order > 0;
+        case Operator::Greater_Equal:
+            return order >= 0;
+        default:
+            return false;
+    }
+}
+
+// call callback with the raw text of every match
+template<typename F>
+inline bool Path::for_each(std::string_view input, F&& callback) const
+{
+    using Token = detail::Tokenizer::Token;
+    const uint64_t accept = 1ULL << steps_.size();
+    uint64_t named = 0;
+    for (size_t i = 0; i < steps_.size(); ++i)
+        if (steps_[i].kind == Step::Kind::Name)
+            named |= 1ULL << i;
+    bool has_filter = std::any_of(steps_.begin(), steps_.end(), [](auto& s) {
+        return s.kind == Step::Kind::Filter;
+    });
+    detail::Tokenizer tokenizer(input);
+    std::vector<Frame> frames{};
+
+    // enter the value of the last token with the given set of states
+    auto visit = [&](Token token, uint64_t states) -> bool {
+        bool container =
+            token == Token::Begin_Object || token == Token::Begin_Array;
+        if (!container && (token == Token::Error || token == Token::End ||
+                           token == Token::Key || token == Token::End_Array ||
+                           token == Token::End_Object))
+            return false;
+        size_t begin = tokenizer.begin_offset();
+        size_t end = tokenizer.end_offset();
+        if (states & accept) {
+            if (container)
+                end = detail::skip_value(input.data(), input.size(), begin);
+            if (end == std::string_view::npos)
+                return false;
+            callback(input.substr(begin, end - begin));
+        }
+        uint64_t live = states & ~accept;
+        if (!container)
+            return true;
+        if (!live)
+            return states & accept ? tokenizer.skip_to(end) : tokenizer.skip();
+        bool array = token == Token::Begin_Array;
+        size_t length = array && needs_length(live)
+                            ? detail::count_elements(
+                                  input.data(), input.size(), begin)
+                            : 0;
+        frames.push_back(Frame{ live, array, 0, length });
+        return true;
+    };
+
+    if (!visit(tokenizer.next(), 1))
+        return false;
+
+    while (!frames.empty()) {
+        Token token = tokenizer.next();
+        if (token == Token::End_Object || token == Token::End_Array) {
+            frames.pop_back();
+            continue;
+        }
+        Frame& frame = frames.back();
+        std::optional<std::string> key{};
+        size_t index = 0;
+        if (!frame.array) {
+            if (token != Token::Key)
+                return false;
+            key = frame.states & named ? detail::unquote(tokenizer.raw())
+                                       : std::string{};
+            token = tokenizer.next();
+        } else {
+            index = frame.index++;
+        }
+        if (token == Token::Error)
+            return false;
+
+        std::string_view value{};
+        if (has_filter) {
+            size_t begin = tokenizer.begin_offset();
+            size_t end =
+                token == Token::Begin_Object || token == Token::Begin_Array
+                    ? detail::skip_value(input.data(), input.size(), begin)
+                    : tokenizer.end_offset();
+            if (end == std::string_view::npos)
+                return false;
+            value = input.substr(begin, end - begin);
+        }
+
+        uint64_t states = 0;
+        for (size_t i = 0; i < steps_.size(); ++i) {
+            if (!(frame.states & (1ULL << i)))
+                continue;
+            if (steps_[i].recursive)
+                states |= 1ULL << i;
+            if (matches(steps_[i], key, index, frame.length, value))
+                states |= 1ULL << (i + 1);
+        }
+
+        if (states) {
+            if (!visit(token, states))
+                return false;
+        } else if ((token == Token::Begin_Object ||
+                    token == Token::Begin_Array) &&
+                   !tokenizer.skip()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+///////////////////////
+// Struct binding
+//////////////////////
+
+// compile-time struct binding, e.g.
+// SIMPLEJSON_BINDING(User, json::field("id", &User::id))
+template<typename T>
+struct Binding;
+
+template<typename T, typename M>
+struct Field
+{
+    std::string_view name;
+    M T::*member;
+};
+
+template<typename T, typename M>
+constexpr Field<T, M> field(std::string_view name, M T::*member)
+{
+    return Field<T, M>{ name, member };
+}
+
+#define SIMPLEJSON_BINDING(Type, ...)                                          \
+    template<>                                                                 \
+    struct json::Binding<Type>                                                 \
+    {                                                                          \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__);           \
+    };
+
+struct Bind_Error
+{
+    // JSON pointer to the offending value, e.g. "/items/2/price"
+    std::string path;
+    size_t offset;
+    std::string message;
+};
+
+namespace detail {
+
+template<typename T, typename = void>
+struct is_bound : std::false_type
+{};
+
+template<typename T>
+struct is_bound<T, std::void_t<decltype(Binding<T>::fields)>> : std::true_type
+{};
+
+template<typename T>
+struct is_optional : std::false_type
+{};
+
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type
+{};
+
+template<typename T>
+struct is_vector : std::false_type
+{};
+
+template<typename T, typename A>
+struct is_vector<std::vector<T, A>> : std::true_type
+{};
+
+template<typename T>
+struct is_string_map : std::false_type
+{};
+
+template<typename T, typename C, typename A>
+struct is_string_map<std::map<std::string, T, C, A>> : std::true_type
+{};
+
+constexpr uint32_t fnv1a(std::string_view key, uint32_t seed) noexcept
+{
+    uint32_t hash = 2166136261u;
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    // avalanche so every seed reshuffles the low bits used as the slot
+    hash ^= seed * 0x9e3779b9u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    return hash;
+}
+
+constexpr size_t table_size(size_t keys) noexcept
+{
+    size_t size = 1;
+    while (size < keys * 2)
+        size <<= 1;
+    return size;
+}
+
+// compile-time perfect hash over a fixed key set
+template<size_t N>
+struct Perfect_Hash
+{
+    static constexpr size_t size = table_size(N);
+
+    constexpr explicit Perfect_Hash(
+        std::array<std::string_view, N> const& keys)
+        : names(keys)
+    {
+        for (uint32_t candidate = 0; candidate < 4096; ++candidate) {
+            for (auto& slot : slots)
+                slot = -1;
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; ++i) {
+                auto& slot = slots[fnv1a(keys[i], candidate) & (size - 1)];
+                collision = slot != -1;
+                slot = static_cast<int>(i);
+            }
+            if (!collision) {
+                seed = candidate;
+                perfect = true;
+                return;
+            }
+        }
+    }
+
+    constexpr int find(std::string_view key) const noexcept
+    {
+        if (perfect) {
+            int index = slots[fnv1a(key, seed) & (size - 1)];
+            return index >= 0 && names[static_cast<size_t>(index)] == key
+                       ? index
+                       : -1;
+        }
+        for (size_t i = 0; i < N; ++i)
+            if (names[i] == key)
+                return static_cast<int>(i);
+        return -1;
+    }
+
+    std::array<std::string_view, N> names{};
+    std::array<int, size> slots{};
+    uint32_t seed = 0;
+    bool perfect = false;
+};
+
+template<typename T>
+struct Binding_Table
+{
+    static constexpr size_t count =
+        std::tuple_size_v<std::decay_t<decltype(Binding<T>::fields)>>;
+
+    static constexpr Perfect_Hash<count> keys{ std::apply(
+        [](auto const&... field) {
+            return std::array<std::string_view, sizeof...(field)>{
+                field.name...
+            };
+        },
+        Binding<T>::fields) };
+
+    template<typename F, size_t... I>
+    static constexpr void visit(size_t index,
+                                F&& callback,
+                                std::index_sequence<I...>)
+    {
+        ((index == I ? (callback(std::get<I>(Binding<T>::fields)), 0) : 0),
+         ...);
+    }
+
+    template<typename F>
+    static constexpr void visit(size_t index, F&& callback)
+    {
+        visit(index,
+              std::forward<F>(callback),
+              std::make_index_sequence<count>{});
+    }
+};
+
+class Binder
+{
+  public:
+    using Token = Tokenizer::Token;
+
+    Binder(std::string_view input, std::vector<Bind_Error>& errors)
+        : input_(input)
+        , tokenizer_(input)
+        , errors_(errors)
+    {
+    }
+
+    template<typename T>
+    bool run(T& value)
+    {
+        if (!read(value, tokenizer_.next()))
+            return false;
+        if (tokenizer_.next() != Token::End)
+            return syntax();
+        return true;
+    }
+
+  private:
+    inline bool syntax()
+    {
+        error(tokenizer_.error() ? tokenizer_.error() : "Malformed input");
+        return false;
+    }
+
+    inline void error(std::string message)
+    {
+        errors_.push_back(Bind_Error{
+            path_, tokenizer_.begin_offset(), std::move(message) });
+    }
+
+    static inline bool is_container(Token token) noexcept
+    {
+        return token == Token::Begin_Object || token == Token::Begin_Array;
+    }
+
+    // report a value of the wrong type and pass over it
+    inline bool mistyped(Token token, const char* expected)
+    {
+        if (token == Token::Error)
+            return syntax();
+        error(std::string("Expected ") + expected);
+        return !is_container(token) || tokenizer_.skip() || syntax();
+    }
+
+    template<typename T>
+    bool read(T& value, Token token)
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            if (token != Token::Boolean)
+                return mistyped(token, "boolean");
+            value = tokenizer_.raw()[0] == 't';
+        } else if constexpr (std::is_integral_v<T>) {
+            auto raw = tokenizer_.raw();
+            T number{};
+            auto [end, status] =
+                std::from_chars(raw.data(), raw.data() + raw.size(), number);
+            if (token != Token::Number || status != std::errc() ||
+                end != raw.data() + raw.size())
+                return mistyped(token, "integer");
+            value = number;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            if (token != Token::Number)
+                return mistyped(token, "number");
+            std::string raw(tokenizer_.raw());
+            value = static_cast<T>(std::strtod(raw.c_str(), nullptr));
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            if (token != Token::String)
+                return mistyped(token, "string");
+            value = unquote(tokenizer_.raw());
+        } else if constexpr (std::is_same_v<T, JSON>) {
+            if (token == Token::Error || token == Token::End ||
+                token == Token::Key)
+                return syntax();
+            size_t begin = tokenizer_.begin_offset();
+            size_t end = is_container(token)
+                             ? skip_value(input_.data(), input_.size(), begin)
+                             : tokenizer_.end_offset();
+            if (is_container(token) && !tokenizer_.skip_to(end))
+                return syntax();
+            value = JSON::load(std::string(input_.substr(begin, end - begin)));
+        } else if constexpr (is_optional<T>::value) {
+            if (token == Token::Null) {
+                value.reset();
+                return true;
+            }
+            return read(value.emplace(), token);
+        } else if constexpr (is_vector<T>::value) {
+            if (token != Token::Begin_Array)
+                return mistyped(token, "array");
+            value.clear();
+            size_t length = path_.size();
+            for (token = tokenizer_.next(); token != Token::End_Array;
+                 token = tokenizer_.next()) {
+                path_ += '/';
+                path_ += std::to_string(value.size());
+                bool ok = read(value.emplace_back(), token);
+                path_.resize(length);
+                if (!ok)
+                    return false;
+            }
+        } else if constexpr (is_string_map<T>::value) {
+            if (token != Token::Begin_Object)
+                return mistyped(token, "object");
+            value.clear();
+            size_t length = path_.size();
+            for (token = tokenizer_.next(); token == Token::Key;
+                 token = tokenizer_.next()) {
+                auto key = unquote(tokenizer_.raw());
+                path_ += '/';
+                path_ += key;
+                bool ok = read(value[key], tokenizer_.next());
+                path_.resize(length);
+                if (!ok)
+                    return false;
+            }
+            if (token != Token::End_Object)
+                return syntax();
+        } else {
+            static_assert(is_bound<T>::value,
+                          "type has no json::Binding, see SIMPLEJSON_BINDING");
+            return read_object(value, token);
+        }
+        return true;
+    }
+
+    template<typename T>
+    bool read_object(T& value, Token token)
+    {
+        using Table = Binding_Table<T>;
+        if (token != Token::Begin_Object)
+            return mistyped(token, "object");
+        std::array<bool, Table::count> seen{};
+        size_t length = path_.size();
+        for (token = tokenizer_.next(); token == Token::Key;
+             token = tokenizer_.next()) {
+            auto raw = tokenizer_.raw().substr(1, tokenizer_.raw().size() - 2);
+            int index = raw.find('\\') == std::string_view::npos
+                            ? Table::keys.find(raw)
+                            : Table::keys.find(unquote(tokenizer_.raw()));
+            token = tokenizer_.next();
+            if (index < 0) {
+                if (token == Token::Error ||
+                    (is_container(token) && !tokenizer_.skip()))
+                    return syntax();
+                continue;
+            }
+            seen[static_cast<size_t>(index)] = true;
+            bool ok = true;
+            Table::visit(static_cast<size_t>(index), [&](auto const& field) {
+                path_ += '/';
+                path_ += field.name;
+                ok = read(value.*(field.member), token);
+                path_.resize(length);
+            });
+            if (!ok)
+                return false;
+        }
+        if (token != Token::End_Object)
+            return syntax();
+        for (size_t i = 0; i < Table::count; ++i) {
+            if (seen[i])
+                continue;
+            Table::visit(i, [&](auto const& field) {
+                using Member = std::decay_t<decltype(value.*(field.member))>;
+                if constexpr (!is_optional<Member>::value)
+                    errors_.push_back(
+                        Bind_Error{ path_ + "/" + std::string(field.name),
+                                    tokenizer_.begin_offset(),
+                                    "Missing field" });
+            });
+        }
+        return true;
+    }
+
+    std::string_view input_;
+    Tokenizer tokenizer_;
+    std::vector<Bind_Error>& errors_;
+    std::string path_{};
+};
+
+} // namespace detail
+
+// parse input directly into a bound type, returns every error found
+template<typename T>
+std::vector<Bind_Error> read(std::string_view input, T& value)
+{
+    std::vector<Bind_Error> errors{};
+    detail::Binder(input, errors).run(value);
+    return errors;
+}
+
+template<typename T, typename W>
+void write(T const& value, W& writer)
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        writer.boolean(value);
+    } else if constexpr (std::is_integral_v<T>) {
+        writer.integral(static_cast<long>(value));
+    } else if constexpr (std::is_floating_point_v<T>) {
+        writer.floating(static_cast<double>(value));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        writer.string(value);
+    } else if constexpr (std::is_same_v<T, JSON>) {
+        writer.write(value);
+    } else if constexpr (detail::is_optional<T>::value) {
+        if (value)
+            write(*value, writer);
+        else
+            writer.null();
+    } else if constexpr (detail::is_vector<T>::value) {
+        writer.begin_array();
+        for (auto const& element : value)
+            write(element, writer);
+        writer.end_array();
+    } else if constexpr (detail::is_string_map<T>::value) {
+        writer.begin_object();
+        for (auto const& [key, element] : value) {
+            writer.key(key);
+            write(element, writer);
+        }
+        writer.end_object();
+    } else {
+        static_assert(detail::is_bound<T>::value,
+                      "type has no json::Binding, see SIMPLEJSON_BINDING");
+        writer.begin_object();
+        std::apply(
+            [&](auto const&... field) {
+                ((writer.key(field.name), write(value.*(field.member), writer)),
+                 ...);
+            },
+            Binding<T>::fields);
+        writer.end_object();
+    }
+}
+
+///////////////////////
+// Binary formats
+//////////////////////
+
+namespace detail {
+
+// Whether a double survives the round trip through a float
+inline bool fits_float(double f)
+{
+    return std::fabs(f) <= FLT_MAX && static_cast<float>(f) == f;
+}
+
+inline uint32_t float_bits(float f)
+{
+    uint32_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+inline uint64_t double_bits(double f)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &f, sizeof(bits));
+    return bits;
+}
+
+// A number in its source form as the narrowest exact binary number
+template<typename W>
+void write_number(std::string_view raw, W& writer)
+{
+    const char* first = raw.data();
+    const char* last = first + raw.size();
+    if (raw.find_first_of(".eE") == std::string_view::npos) {
+        long integral = 0;
+        auto [end, status] = std::from_chars(first, last, integral);
+        if (status == std::errc() && end == last)
+            return writer.integral(integral);
+        unsigned long magnitude = 0;
+        auto [uend, ustatus] = std::from_chars(first, last, magnitude);
+        if (ustatus == std::errc() && uend == last)
+            return writer.unsigned_integral(magnitude);
+    }
+    writer.floating(std::strtod(std::string(raw).c_str(), nullptr));
+}
+
+// build a document from Writer events, the inverse of emit()
+class Builder
+{
+  public:
+    inline void null() { value(JSON()); }
+    inline void boolean(bool b) { value(JSON(b)); }
+    inline void integral(long i) { value(JSON(i)); }
+    inline void floating(double f) { value(JSON(f)); }
+    inline void string(std::string_view str) { value(JSON(std::string(str))); }
+
+    inline void unsigned_integral(unsigned long u)
+    {
+        if (u <= static_cast<unsigned long>(LONG_MAX))
+            integral(static_cast<long>(u));
+        else
+            number(std::to_string(u));
+    }
+
+    // kept as text like Options::lazy_numbers, see JSON::raw_number
+    inline void number(std::string_view raw)
+    {
+        value(number_text(raw,
+                          raw.find_first_of(".eE") != std::string_view::npos));
+    }
+
+    inline void key(std::string_view key)
+    {
+        stack_.back().key = json_escape(std::string(key));
+    }
+
+    inline void begin_object(size_t = 0) { open(JSON::Class::Object); }
+    inline void begin_array(size_t = 0) { open(JSON::Class::Array); }
+    inline void end_object() { close(); }
+    inline void end_array() { close(); }
+
+    inline JSON take() noexcept { return std::move(root_); }
+
+  private:
+    struct Frame
+    {
+        JSON container;
+        std::string key;
+    };
+
+    inline void open(JSON::Class type)
+    {
+        stack_.push_back(Frame{ JSON::make(type), {} });
+    }
+
+    inline void close()
+    {
+        JSON container = std::move(stack_.back().container);
+        stack_.pop_back();
+        value(std::move(container));
+    }
+
+    inline void value(JSON&& value)
+    {
+        if (stack_.empty()) {
+            root_ = std::move(value);
+            return;
+        }
+        auto& top = stack_.back();
+        if (top.container.JSON_type() == JSON::Class::Object)
+            member(*top.container.Internal.Map.value(), top.key) =
+                std::move(value);
+        else
+            top.container.Internal.List.value()->emplace_back(
+                std::move(value));
+    }
+
+    std::vector<Frame> stack_{};
+    JSON root_{};
+};
+
+} // namespace detail
+
+// event-driven MessagePack encoder
+class Msgpack_Writer
+{
+  public:
+    static constexpr size_t unknown = static_cast<size_t>(-1);
+
+    inline void null()
+    {
+        item();
+        put(0xc0);
+    }
+
+    inline void boolean(bool b)
+    {
+        item();
+        put(b ? 0xc3 : 0xc2);
+    }
+
+    inline void number(std::string_view raw)
+    {
+        detail::write_number(raw, *this);
+    }
+
+    inline void integral(long i)
+    {
+        if (i >= 0)
+            return unsigned_integral(static_cast<unsigned long>(i));
+        item();
+        if (i >= -32)
+            put(static_cast<uint8_t>(i));
+        else if (i >= INT8_MIN)
+            put(0xd0, static_cast<int8_t>(i));
+        else if (i >= INT16_MIN)
+            put(0xd1, static_cast<int16_t>(i));
+        else if (i >= INT32_MIN)
+            put(0xd2, static_cast<int32_t>(i));
+        else
+            put(0xd3, static_cast<int64_t>(i));
+    }
+
+    inline void unsigned_integral(unsigned long u)
+    {
+        item();
+        if (u <= 0x7f)
+            put(static_cast<uint8_t>(u));
+        else if (u <= UINT8_MAX)
+            put(0xcc, static_cast<uint8_t>(u));
+        else if (u <= UINT16_MAX)
+            put(0xcd, static_cast<uint16_t>(u));
+        else if (u <= UINT32_MAX)
+            put(0xce, static_cast<uint32_t>(u));
+        else
+            put(0xcf, static_cast<uint64_t>(u));
+    }
+
+    inline void floating(double f)
+    {
+        item();
+        if (detail::fits_float(f))
+            put(0xca, detail::float_bits(static_cast<float>(f)));
+        else
+            put(0xcb, detail::double_bits(f));
+    }
+
+    inline void string(std::string_view str)
+    {
+        item();
+        key(str);
+    }
+
+    // keys are plain text, unlike Writer::key
+    inline void key(std::string_view key)
+    {
+        header(key.size(), 0xa0, 32, 0xd9, 0xda, 0xdb);
+        out_.insert(out_.end(), key.begin(), key.end());
+    }
+
+    inline void begin_object(size_t count = unknown)
+    {
+        open(count, 0x80, 0xde, 0xdf);
+    }
+
+    inline void begin_array(size_t count = unknown)
+    {
+        open(count, 0x90, 0xdc, 0xdd);
+    }
+
+    inline void end_object() { close(); }
+    inline void end_array() { close(); }
+
+    inline void write(JSON const& value) { detail::emit(value, *this, true); }
+
+    inline std::vector<uint8_t> const& bytes() const noexcept { return out_; }
+    inline std::vector<uint8_t> take() noexcept { return std::move(out_); }
+
+  private:
+    struct Level
+    {
+        size_t patch;
+        size_t count;
+    };
+
+    inline void put(uint8_t byte) { out_.push_back(byte); }
+
+    // a tag followed by a big-endian value
+    template<typename T>
+    inline void put(uint8_t tag, T value)
+    {
+        out_.push_back(tag);
+        for (size_t shift = sizeof(T) * 8; shift > 0;) {
+            shift -= 8;
+            out_.push_back(static_cast<uint8_t>(
+                static_cast<uint64_t>(value) >> shift));
+        }
+    }
+
+    inline void header(size_t size,
+                       uint8_t fix,
+                       size_t fix_limit,
+                       uint8_t tag8,
+                       uint8_t tag16,
+                       uint8_t tag32)
+    {
+        if (size < fix_limit)
+            put(static_cast<uint8_t>(fix | size));
+        else if (tag8 && size <= UINT8_MAX)
+            put(tag8, static_cast<uint8_t>(size));
+        else if (size <= UINT16_MAX)
+            put(tag16, static_cast<uint16_t>(size));
+        else
+            put(tag32, static_cast<uint32_t>(size));
+    }
+
+    // counts the elements of containers opened without a size
+    inline void item()
+    {
+        if (!levels_.empty())
+            ++levels_.back().count;
+    }
+
+    inline void open(size_t count, uint8_t fix, uint8_t tag16, uint8_t tag32)
+    {
+        item();
+        if (count == unknown) {
+            levels_.push_back(Level{ out_.size(), 0 });
+            put(tag32, uint32_t{ 0 });
+        } else {
+            levels_.push_back(Level{ unknown, 0 });
+            header(count, fix, 16, 0, tag16, tag32);
+        }
+    }
+
+    inline void close()
+    {
+        Level level = levels_.back();
+        levels_.pop_back();
+        if (level.patch == unknown)
+            return;
+        for (size_t i = 0; i < 4; ++i)
+            out_[level.patch + 1 + i] =
+                static_cast<uint8_t>(level.count >> (24 - 8 * i));
+    }
+
+    std::vector<uint8_t> out_{};
+    std::vector<Level> levels_{};
+};
+
+// event-driven CBOR (RFC 8949) encoder
+class Cbor_Writer
+{
+  public:
+    static constexpr size_t unknown = static_cast<size_t>(-1);
+
+    inline void null() { put(0xf6); }
+    inline void boolean(bool b) { put(b ? 0xf5 : 0xf4); }
+    inline void number(std::string_view raw)
+    {
+        detail::write_number(raw, *this);
+    }
+
+    inline void integral(long i)
+    {
+        if (i >= 0)
+            head(0, static_cast<uint64_t>(i));
+        else // -1 - n, without overflowing on LONG_MIN
+            head(1, static_cast<uint64_t>(-(i + 1)));
+    }
+
+    inline void unsigned_integral(unsigned long u) { head(0, u); }
+
+    inline void floating(double f)
+    {
+        if (detail::fits_float(f)) {
+            put(0xfa);
+            big_endian(detail::float_bits(static_cast<float>(f)), 4);
+        } else {
+            put(0xfb);
+            big_endian(detail::double_bits(f), 8);
+        }
+    }
+
+    inline void string(std::string_view str)
+    {
+        head(3, str.size());
+        out_.insert(out_.end(), str.begin(), str.end());
+    }
+
+    // keys are plain text, unlike Writer::key
+    inline void key(std::string_view key) { string(key); }
+
+    inline void begin_object(size_t count = unknown) { open(5, count); }
+    inline void begin_array(size_t count = unknown) { open(4, count); }
+    inline void end_object() { close(); }
+    inline void end_array() { close(); }
+
+    inline void write(JSON const& value) { detail::emit(value, *this, true); }
+
+    inline std::vector<uint8_t> const& bytes() const noexcept { return out_; }
+    inline std::vector<uint8_t> take() noexcept { return std::move(out_); }
+
+  private:
+    inline void put(uint8_t byte) { out_.push_back(byte); }
+
+    inline void big_endian(uint64_t value, size_t width)
+    {
+        while (width-- > 0)
+            out_.push_back(static_cast<uint8_t>(value >> (8 * width)));
+    }
+
+    // the initial byte of a data item and its argument
+    inline void head(uint8_t major, uint64_t argument)
+    {
+        uint8_t type = static_cast<uint8_t>(major << 5);
+        if (argument < 24) {
+            put(static_cast<uint8_t>(type | argument));
+        } else if (argument <= UINT8_MAX) {
+            put(type | 24);
+            big_endian(argument, 1);
+        } else if (argument <= UINT16_MAX) {
+            put(type | 25);
+            big_endian(argument, 2);
+        } else if (argument <= UINT32_MAX) {
+            put(type | 26);
+            big_endian(argument, 4);
+        } else {
+            put(type | 27);
+            big_endian(argument, 8);
+        }
+    }
+
+    inline void open(uint8_t major, size_t count)
+    {
+        indefinite_.push_back(count == unknown);
+        if (count == unknown)
+            put(static_cast<uint8_t>(major << 5 | 31));
+        else
+            head(major, count);
+    }
+
+    inline void close()
+    {
+        if (indefinite_.back())
+            put(0xff);
+        indefinite_.pop_back();
+    }
+
+    std::vector<uint8_t> out_{};
+    std::vector<bool> indefinite_{};
+};
+
+namespace detail {
+
+// Replays MessagePack as Writer events, false with error set on malformed
+// input
+template<typename Sink>
+bool read_msgpack(uint8_t const* data,
+                  size_t size,
+                  Sink& sink,
+                  size_t max_depth,
+                  Parse_Error& error)
+{
+    using Code = Parse_Error::Code;
+    struct Frame
+    {
+        size_t remaining;
+        bool object;
+        bool key_next;
+    };
+    std::vector<Frame> stack{};
+    size_t offset = 0;
+
+    auto fail = [&](Code code) {
+        error.code = code;
+        error.offset = offset;
+        return false;
+    };
+    auto fetch = [&](size_t width, uint64_t& value) {
+        if (size - offset < width)
+            return false;
+        value = 0;
+        for (size_t i = 0; i < width; ++i)
+            value = value << 8 | data[offset++];
+        return true;
+    };
+    // the payload length of a string, binary or container tag
+    auto length = [&](uint8_t tag, uint64_t& value) {
+        switch (tag) {
+            case 0xc4:
+            case 0xd9:
+                return fetch(1, value);
+            case 0xc5:
+            case 0xda:
+            case 0xdc:
+            case 0xde:
+                return fetch(2, value);
+            case 0xc6:
+            case 0xdb:
+            case 0xdd:
+            case 0xdf:
+                return fetch(4, value);
+            default:
+                value = tag & (tag >= 0xa0 ? 0x1f : 0x0f);
+                return true;
+        }
+    };
+
+    while (true) {
+        if (offset >= size)
+            return fail(Code::unexpected_end);
+        uint8_t tag = data[offset++];
+        uint64_t value = 0;
+        bool is_string = (tag >= 0xa0 && tag <= 0xbf) ||
+                         (tag >= 0xc4 && tag <= 0xc6) ||
+                         (tag >= 0xd9 && tag <= 0xdb);
+
+        if (!stack.empty() && stack.back().key_next) {
+            if (!is_string)
+                return fail(Code::expected_key);
+            if (!length(tag, value) || size - offset < value)
+                return fail(Code::unexpected_end);
+            sink.key(std::string_view(
+                reinterpret_cast<const char*>(data + offset), value));
+            offset += value;
+            --stack.back().remaining;
+            stack.back().key_next = false;
+            continue;
+        }
+
+        bool is_array = (tag >= 0x90 && tag <= 0x9f) || tag == 0xdc ||
+                        tag == 0xdd;
+        bool is_object = (tag >= 0x80 && tag <= 0x8f) || tag == 0xde ||
+                         tag == 0xdf;
+        if (is_string) {
+            if (!length(tag, value) || size - offset < value)
+                return fail(Code::unexpected_end);
+            sink.string(std::string_view(
+                reinterpret_cast<const char*>(data + offset), value));
+            offset += value;
+        } else if (is_array || is_object) {
+            if (stack.size() >= max_depth)
+                return fail(Code::max_depth);
+            // every element takes at least a byte
+            if (!length(tag, value) || value > size - offset)
+                return fail(Code::unexpected_end);
+            if (is_object)
+                sink.begin_object(value);
+            else
+                sink.begin_array(value);
+            if (value > 0) {
+                stack.push_back(Frame{
+                    is_object ? value * 2 : value, is_object, is_object });
+                continue;
+            }
+            if (is_object)
+                sink.end_object();
+            else
+                sink.end_array();
+        } else if (tag <= 0x7f) {
+            sink.integral(tag);
+        } else if (tag >= 0xe0) {
+            sink.integral(static_cast<int8_t>(tag));
+        } else {
+            switch (tag) {
+                case 0xc0:
+                    sink.null();
+                    break;
+                case 0xc2:
+                case 0xc3:
+                    sink.boolean(tag == 0xc3);
+                    break;
+                case 0xca: {
+                    if (!fetch(4, value))
+                        return fail(Code::unexpected_end);
+                    float f = 0;
+                    uint32_t bits = static_cast<uint32_t>(value);
+                    std::memcpy(&f, &bits, sizeof(f));
+                    sink.floating(f);
+                } break;
+                case 0xcb: {
+                    if (!fetch(8, value))
+                        return fail(Code::unexpected_end);
+                    double f = 0;
+                    std::memcpy(&f, &value, sizeof(f));
+                    sink.floating(f);
+                } break;
+                case 0xcc:
+                case 0xcd:
+                case 0xce:
+                case 0xcf:
+                    if (!fetch(size_t{ 1 } << (tag - 0xcc), value))
+                        return fail(Code::unexpected_end);
+                    sink.unsigned_integral(value);
+                    break;
+                case 0xd0:
+                case 0xd1:
+                case 0xd2:
+                case 0xd3: {
+                    size_t width = size_t{ 1 } << (tag - 0xd0);
+                    if (!fetch(width, value))
+                        return fail(Code::unexpected_end);
+                    // sign-extend from the top bit of the payload
+                    uint64_t sign = uint64_t{ 1 } << (width * 8 - 1);
+                    sink.integral(
+                        static_cast<long>(static_cast<int64_t>(
+                            (value ^ sign) - sign)));
+                } break;
+                default:
+                    --offset;
+                    return fail(Code::unexpected_character);
+            }
+        }
+
+        // a value is complete, close every container it fills
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            top.key_next = top.object;
+            if (--top.remaining > 0)
+                break;
+            if (top.object)
+                sink.end_object();
+            else
+                sink.end_array();
+            stack.pop_back();
+        }
+        if (stack.empty())
+            break;
+    }
+    if (offset != size)
+        return fail(Code::trailing_content);
+    return true;
+}
+
+// Replays CBOR as Writer events, false with error set on malformed input
+template<typename Sink>
+bool read_cbor(uint8_t const* data,
+               size_t size,
+               Sink& sink,
+               size_t max_depth,
+               Parse_Error& error)
+{
+    using Code = Parse_Error::Code;
+    static constexpr uint64_t indefinite = static_cast<uint64_t>(-1);
+    struct Frame
+    {
+        uint64_t remaining;
+        bool object;
+        bool key_next;
+    };
+    std::vector<Frame> stack{};
+    std::string chunks{};
+    // the current item has indefinite length
+    bool chunked = false;
+    size_t offset = 0;
+
+    auto fail = [&](Code code) {
+        error.code = code;
+        error.offset = offset;
+        return false;
+    };
+    // the argument of the data item whose initial byte was just read
+    auto argument = [&](uint8_t info, uint64_t& value) {
+        if (info < 24 || info == 31) {
+            value = info;
+            return true;
+        }
+        if (info > 27)
+            return false;
+        size_t width = size_t{ 1 } << (info - 24);
+        if (size - offset < width)
+            return false;
+        value = 0;
+        for (size_t i = 0; i < width; ++i)
+            value = value << 8 | data[offset++];
+        return true;
+    };
+    // a text or byte string, joining the chunks of an indefinite one
+    auto text = [&](uint8_t major, uint64_t length, std::string_view& out) {
+        if (!chunked) {
+            if (size - offset < length)
+                return false;
+            out = std::string_view(
+                reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+            return true;
+        }
+        chunks.clear();
+        while (offset < size && data[offset] != 0xff) {
+            uint8_t initial = data[offset++];
+            uint64_t chunk = 0;
+            if (initial >> 5 != major || (initial & 0x1f) == 31 ||
+                !argument(initial & 0x1f, chunk) || size - offset < chunk)
+                return false;
+            chunks.append(reinterpret_cast<const char*>(data + offset), chunk);
+            offset += chunk;
+        }
+        if (offset >= size)
+            return false;
+        ++offset;
+        out = chunks;
+        return true;
+    };
+
+    while (true) {
+        if (offset >= size)
+            return fail(Code::unexpected_end);
+        uint8_t initial = data[offset++];
+        uint8_t major = initial >> 5;
+        uint64_t value = 0;
+        chunked = (initial & 0x1f) == 31;
+
+        if (initial == 0xff) {
+            if (stack.empty() || stack.back().remaining != indefinite ||
+                (stack.back().object && !stack.back().key_next))
+                return fail(Code::unexpected_character);
+            if (stack.back().object)
+                sink.end_object();
+            else
+                sink.end_array();
+            stack.pop_back();
+        } else {
+            if (!argument(initial & 0x1f, value) ||
+                (chunked && (major < 2 || major > 5)))
+                return fail(Code::unexpected_character);
+            if (major == 6) // tags carry no meaning in a JSON document
+                continue;
+
+            if (!stack.empty() && stack.back().key_next) {
+                std::string_view key{};
+                if (major != 2 && major != 3)
+                    return fail(Code::expected_key);
+                if (!text(major, value, key))
+                    return fail(Code::unexpected_end);
+                sink.key(key);
+                if (stack.back().remaining != indefinite)
+                    --stack.back().remaining;
+                stack.back().key_next = false;
+                continue;
+            }
+
+            switch (major) {
+                case 0:
+                    sink.unsigned_integral(value);
+                    break;
+                case 1:
+                    if (value <= static_cast<uint64_t>(LONG_MAX))
+                        sink.integral(-1 - static_cast<long>(value));
+                    else if (value == UINT64_MAX)
+                        sink.number("-18446744073709551616");
+                    else
+                        sink.number("-" + std::to_string(value + 1));
+                    break;
+                case 2:
+                case 3: {
+                    std::string_view str{};
+                    if (!text(major, value, str))
+                        return fail(Code::unexpected_end);
+                    sink.string(str);
+                } break;
+                case 4:
+                case 5: {
+                    // every element takes at least a byte
+                    if (!chunked && value > size - offset)
+                        return fail(Code::unexpected_end);
+                    if (stack.size() >= max_depth)
+                        return fail(Code::max_depth);
+                    bool is_object = major == 5;
+                    if (chunked && is_object)
+                        sink.begin_object();
+                    else if (chunked)
+                        sink.begin_array();
+                    else if (is_object)
+                        sink.begin_object(value);
+                    else
+                        sink.begin_array(value);
+                    if (chunked) {
+                        stack.push_back(
+                            Frame{ indefinite, is_object, is_object });
+                        continue;
+                    }
+                    if (value > 0) {
+                        stack.push_back(Frame{ is_object ? value * 2 : value,
+                                               is_object,
+                                               is_object });
+                        continue;
+                    }
+                    if (is_object)
+                        sink.end_object();
+                    else
+                        sink.end_array();
+                } break;
+                case 7:
+                    switch (initial & 0x1f) {
+                        case 20:
+                        case 21:
+                            sink.boolean((initial & 0x1f) == 21);
+                            break;
+                        case 22:
+                        case 23:
+                            sink.null();
+                            break;
+                        case 25: {
+                            // half precision, exponent 0 is subnormal
+                            int exponent = (value >> 10) & 0x1f;
+                            double f = static_cast<double>(value & 0x3ff);
+                            if (exponent == 31)
+                                f = f == 0 ? HUGE_VAL : NAN;
+                            else if (exponent == 0)
+                                f = std::ldexp(f, -24);
+                            else
+                                f = std::ldexp(f + 1024, exponent - 25);
+                            sink.floating(value & 0x8000 ? -f : f);
+                        } break;
+                        case 26: {
+                            float f = 0;
+                            uint32_t bits = static_cast<uint32_t>(value);
+                            std::memcpy(&f, &bits, sizeof(f));
+                            sink.floating(f);
+                        } break;
+                        case 27: {
+                            double f = 0;
+                            std::memcpy(&f, &value, sizeof(f));
+                            sink.floating(f);
+                        } break;
+                        default:
+                            return fail(Code::unexpected_character);
+                    }
+                    break;
+            }
+        }
+
+        // a value is complete, close every definite container it fills
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            top.key_next = top.object;
+            if (top.remaining == indefinite || --top.remaining > 0)
+                break;
+            if (top.object)
+                sink.end_object();
+            else
+                sink.end_array();
+            stack.pop_back();
+        }
+        if (stack.empty())
+            break;
+    }
+    if (offset != size)
+        return fail(Code::trailing_content);
+    return true;
+}
+
+} // namespace detail
+
+// MessagePack encoding of a document
+inline std::vector<uint8_t> to_msgpack(JSON const& value)
+{
+    Msgpack_Writer writer;
+    writer.write(value);
+    return writer.take();
+}
+
+inline std::vector<uint8_t> to_cbor(JSON const& value)
+{
+    Cbor_Writer writer;
+    writer.write(value);
+    return writer.take();
+}
+
+// decode a single MessagePack value, null on malformed input
+inline JSON from_msgpack(void const* data,
+                         size_t size,
+                         Parse_Error& error,
+                         Options const& options = Options{})
+{
+    Resource_Scope scope(detail::resource_for(options));
+    detail::Builder builder;
+    error = Parse_Error{};
+    if (!detail::read_msgpack(static_cast<uint8_t const*>(data),
+                              size,
+                              builder,
+                              options.max_depth,
+                              error))
+        return JSON();
+    return builder.take();
+}
+
+inline JSON from_msgpack(void const* data,
+                         size_t size,
+                         Options const& options = Options{})
+{
+    Parse_Error error{};
+    return from_msgpack(data, size, error, options);
+}
+
+inline JSON from_msgpack(std::vector<uint8_t> const& bytes,
+                         Parse_Error& error,
+                         Options const& options = Options{})
+{
+    return from_msgpack(bytes.data(), bytes.size(), error, options);
+}
+
+inline JSON from_msgpack(std::vector<uint8_t> const& bytes,
+                         Options const& options = Options{})
+{
+    return from_msgpack(bytes.data(), bytes.size(), options);
+}
+
+// Decodes a single CBOR data item, null on malformed input. Tags are skipped
+inline JSON from_cbor(void const* data,
+                      size_t size,
+                      Parse_Error& error,
+                      Options const& options = Options{})
+{
+    Resource_Scope scope(detail::resource_for(options));
+    detail::Builder builder;
+    error = Parse_Error{};
+    if (!detail::read_cbor(static_cast<uint8_t const*>(data),
+                           size,
+                           builder,
+                           options.max_depth,
+                           error))
+        return JSON();
+    return builder.take();
+}
+
+inline JSON from_cbor(void const* data,
+                      size_t size,
+                      Options const& options = Options{})
+{
+    Parse_Error error{};
+    return from_cbor(data, size, error, options);
+}
+
+inline JSON from_cbor(std::vector<uint8_t> const& bytes,
+                      Parse_Error& error,
+                      Options const& options = Options{})
+{
+    return from_cbor(bytes.data(), bytes.size(), error, options);
+}
+
+inline JSON from_cbor(std::vector<uint8_t> const& bytes,
+                      Options const& options = Options{})
+{
+    return from_cbor(bytes.data(), bytes.size(), options);
+}
+
+///////////////////////
+// Schema
+//////////////////////
+
+struct Schema_Error
+{
+    // JSON pointer to the offending value
+    std::string path;
+    // byte offset of the offending value in the input
+    size_t offset;
+    std::string message;
+};
+
+namespace detail {
+
+// Copy with every number that holds an integer stored as one, so 1 and
+// 1.0 compare and hash alike, as JSON Schema compares numbers by value
+inline JSON schema_value(JSON const& value)
+{
+    struct Canonical : Builder
+    {
+        inline void floating(double f)
+        {
+            if (f == std::floor(f) && f >= -0x1p63 && f < 0x1p63)
+                integral(static_cast<long>(f));
+            else
+                Builder::floating(f);
+        }
+        inline void number(std::string_view raw)
+        {
+            long i = 0;
+            auto [end, status] =
+                std::from_chars(raw.data(), raw.data() + raw.size(), i);
+            if (status == std::errc() && end == raw.data() + raw.size())
+                integral(i);
+            else if (raw.find_first_of(".eE") != std::string_view::npos)
+                floating(std::strtod(std::string(raw).c_str(), nullptr));
+            else
+                Builder::number(raw);
+        }
+    };
+    Canonical builder{};
+    emit(value, builder, true);
+    return builder.take();
+}
+
+} // namespace detail
+
+// JSON Schema (draft 2020-12 subset) validated over the tokenizer
+class Schema
+{
+  public:
+    using Token = detail::Tokenizer::Token;
+
+    // std::nullopt if the schema is malformed
+    static std::optional<Schema> compile(JSON const& schema)
+    {
+        Schema result{};
+        result.program_.emplace_back();
+        if (schema.JSON_type() == JSON::Class::Object)
+            for (auto& [key, value] : schema.object_range())
+                if (key == "$defs" || key == "definitions") {
+                    if (value.JSON_type() != JSON::Class::Object)
+                        return std::nullopt;
+                    for (auto& [name, definition] : value.object_range()) {
+                        result.definitions_.emplace_back(
+                            "#/" + key + "/" + name,
+                            static_cast<uint32_t>(result.program_.size()));
+                        result.program_.emplace_back();
+                    }
+                }
+        if (!result.compile_into(0, schema))
+            return std::nullopt;
+        if (schema.JSON_type() != JSON::Class::Object)
+            return result;
+        for (auto& [key, value] : schema.object_range())
+            if (key == "$defs" || key == "definitions")
+                for (auto& [name, definition] : value.object_range())
+                    if (!result.compile_into(
+                            *result.resolve("#/" + key + "/" + name),
+                            definition))
+                        return std::nullopt;
+        return result;
+    }
+
+    // The first violation in input, std::nullopt if it is valid
+    std::optional<Schema_Error> validate(std::string_view input) const
+    {
+        std::string path{};
+        return check(input, 0, path, 0, false);
+    }
+
+  private:
+    static constexpr uint32_t any = UINT32_MAX;
+
+    enum Types : uint8_t
+    {
+        Null = 1,
+        Boolean = 2,
+        Object = 4,
+        Array = 8,
+        Number = 16,
+        Integer = 32,
+        String = 64,
+        All = 127
+    };
+
+    struct Property
+    {
+        std::string key;
+        uint32_t schema;
+    };
+
+    struct Node
+    {
+        uint8_t types = All;
+        double minimum = -HUGE_VAL;
+        double maximum = HUGE_VAL;
+        bool exclusive_minimum = false;
+        bool exclusive_maximum = false;
+        double multiple_of = 0.0;
+        size_t min_length = 0;
+        size_t max_length = SIZE_MAX;
+        size_t min_items = 0;
+        size_t max_items = SIZE_MAX;
+        size_t min_properties = 0;
+        size_t max_properties = SIZE_MAX;
+        std::vector<Property> properties{};
+        std::vector<std::string> required{};
+        uint32_t additional = any;
+        std::vector<uint32_t> prefix_items{};
+        uint32_t items = any;
+        // keywords below need the whole value and run over its span
+        bool whole = false;
+        bool unique_items = false;
+        std::optional<std::vector<JSON>> enumeration{};
+        std::vector<uint32_t> all_of{};
+        std::vector<uint32_t> any_of{};
+        std::vector<uint32_t> one_of{};
+        uint32_t negated = any;
+    };
+
+    struct Hash
+    {
+        size_t operator()(JSON const& value) const noexcept
+        {
+            return value.hash();
+        }
+    };
+
+    struct Frame
+    {
+        uint32_t schema;
+        bool is_object;
+        size_t count;
+        size_t path_length;
+        std::vector<bool> seen;
+    };
+
+    static inline std::string decode_key(std::string_view key)
+    {
+        return detail::unquote("\"" + std::string(key) + "\"");
+    }
+
+    inline std::optional<uint32_t> resolve(std::string_view ref) const
+    {
+        if (ref == "#")
+            return 0;
+        for (auto& [name, index] : definitions_)
+            if (name == ref)
+                return index;
+        return std::nullopt;
+    }
+
+    static inline bool number(JSON const& value, double& out)
+    {
+        if (value.JSON_type() == JSON::Class::Integral)
+            out = static_cast<double>(value.to_int());
+        else if (value.JSON_type() == JSON::Class::Floating)
+            out = value.to_float();
+        else
+            return false;
+        return true;
+    }
+
+    static inline bool count(JSON const& value, size_t& out)
+    {
+        if (value.JSON_type() != JSON::Class::Integral || value.to_int() < 0)
+            return false;
+        out = static_cast<size_t>(value.to_int());
+        return true;
+    }
+
+    static inline uint8_t type_bit(std::string const& name)
+    {
+        if (name == "null")
+            return Null;
+        if (name == "boolean")
+            return Boolean;
+        if (name == "object")
+            return Object;
+        if (name == "array")
+            return Array;
+        if (name == "number")
+            return Number;
+        if (name == "integer")
+            return Integer;
+        if (name == "string")
+            return String;
+        return 0;
+    }
+
+    // compile a subschema, aliasing a bare $ref to its target
+    std::optional<uint32_t> compile_child(JSON const& schema)
+    {
+        if (schema.JSON_type() == JSON::Class::Boolean && schema.to_bool())
+            return any;
+        if (schema.JSON_type() == JSON::Class::Object && schema.size() == 1 &&
+            schema.has_key("$ref")) {
+            for (auto& [key, value] : schema.object_range())
+                if (value.JSON_type() == JSON::Class::String)
+                    return resolve(decode_key(value.to_string()));
+            return std::nullopt;
+        }
+        auto index = static_cast<uint32_t>(program_.size());
+        program_.emplace_back();
+        if (!compile_into(index, schema))
+            return std::nullopt;
+        return index;
+    }
+
+    bool compile_list(JSON const& value, std::vector<uint32_t>& out)
+    {
+        if (value.JSON_type() != JSON::Class::Array || value.length() == 0)
+            return false;
+        for (auto& schema : value.array_range()) {
+            auto index = compile_child(schema);
+            if (!index)
+                return false;
+            out.push_back(*index);
+        }
+        return true;
+    }
+
+    bool compile_into(uint32_t index, JSON const& schema)
+    {
+        if (schema.JSON_type() == JSON::Class::Boolean) {
+            program_[index].types = schema.to_bool() ? All : 0;
+            return true;
+        }
+        if (schema.JSON_type() != JSON::Class::Object)
+            return false;
+        // program_ may grow while compiling children, so work on a copy
+        Node node{};
+        bool ok = true;
+        for (auto& [key, value] : schema.object_range()) {
+            double limit = 0.0;
+            if (key == "type") {
+                node.types = 0;
+                if (value.JSON_type() == JSON::Class::String)
+                    node.types = type_bit(decode_key(value.to_string()));
+                else if (value.JSON_type() == JSON::Class::Array)
+                    for (auto& name : value.array_range()) {
+                        uint8_t bit = name.JSON_type() == JSON::Class::String
+                                          ? type_bit(decode_key(
+                                                name.to_string()))
+                                          : 0;
+                        ok = ok && bit != 0;
+                        node.types |= bit;
+                    }
+                ok = ok && node.types != 0;
+            } else if (key == "enum") {
+                ok = value.JSON_type() == JSON::Class::Array;
+                if (ok) {
+                    node.enumeration.emplace();
+                    for (auto& allowed : value.array_range())
+                        node.enumeration->push_back(
+                            detail::schema_value(allowed));
+                }
+            } else if (key == "const") {
+                node.enumeration.emplace(1, detail::schema_value(value));
+            } else if (key == "minimum") {
+                ok = number(value, node.minimum);
+            } else if (key == "maximum") {
+                ok = number(value, node.maximum);
+            } else if (key == "exclusiveMinimum") {
+                ok = number(value, limit);
+                if (ok && limit >= node.minimum) {
+                    node.minimum = limit;
+                    node.exclusive_minimum = true;
+                }
+            } else if (key == "exclusiveMaximum") {
+                ok = number(value, limit);
+                if (ok && limit <= node.maximum) {
+                    node.maximum = limit;
+                    node.exclusive_maximum = true;
+                }
+            } else if (key == "multipleOf") {
+                ok = number(value, node.multiple_of) && node.multiple_of > 0;
+            } else if (key == "minLength") {
+                ok = count(value, node.min_length);
+            } else if (key == "maxLength") {
+                ok = count(value, node.max_length);
+            } else if (key == "minItems") {
+                ok = count(value, node.min_items);
+            } else if (key == "maxItems") {
+                ok = count(value, node.max_items);
+            } else if (key == "minProperties") {
+                ok = count(value, node.min_properties);
+            } else if (key == "maxProperties") {
+                ok = count(value, node.max_properties);
+            } else if (key == "uniqueItems") {
+                ok = value.JSON_type() == JSON::Class::Boolean;
+                node.unique_items = value.to_bool();
+            } else if (key == "required") {
+                ok = value.JSON_type() == JSON::Class::Array;
+                for (auto& name : value.array_range()) {
+                    ok = ok && name.JSON_type() == JSON::Class::String;
+                    node.required.push_back(decode_key(name.to_string()));
+                }
+            } else if (key == "properties") {
+                ok = value.JSON_type() == JSON::Class::Object;
+                for (auto& [name, property] : value.object_range()) {
+                    auto child = ok ? compile_child(property) : std::nullopt;
+                    ok = child.has_value();
+                    if (ok)
+                        node.properties.push_back(
+                            Property{ decode_key(name), *child });
+                }
+            } else if (key == "additionalProperties") {
+                auto child = compile_child(value);
+                ok = child.has_value();
+                node.additional = child.value_or(any);
+            } else if (key == "items") {
+                auto child = compile_child(value);
+                ok = child.has_value();
+                node.items = child.value_or(any);
+            } else if (key == "prefixItems") {
+                ok = compile_list(value, node.prefix_items);
+            } else if (key == "allOf") {
+                ok = compile_list(value, node.all_of);
+            } else if (key == "anyOf") {
+                ok = compile_list(value, node.any_of);
+            } else if (key == "oneOf") {
+                ok = compile_list(value, node.one_of);
+            } else if (key == "not") {
+                // "not": true rejects everything, so it needs a real node
+                auto child = compile_child(value);
+                if (child == any) {
+                    child = static_cast<uint32_t>(program_.size());
+                    program_.emplace_back();
+                }
+                ok = child.has_value();
+                node.negated = child.value_or(any);
+            } else if (key == "$ref") {
+                auto target = value.JSON_type() == JSON::Class::String
+                                  ? resolve(decode_key(value.to_string()))
+                                  : std::nullopt;
+                ok = target.has_value();
+                if (ok)
+                    node.all_of.push_back(*target);
+            }
+            if (!ok)
+                return false;
+        }
+        std::sort(node.properties.begin(),
+                  node.properties.end(),
+                  [](Property const& a, Property const& b) {
+                      return a.key < b.key;
+                  });
+        node.whole = node.unique_items || node.enumeration ||
+                     !node.all_of.empty() || !node.any_of.empty() ||
+                     !node.one_of.empty() || node.negated != any;
+        program_[index] = std::move(node);
+        return true;
+    }
+
+    static inline uint32_t property(Node const& node, std::string const& key)
+    {
+        auto it = std::lower_bound(node.properties.begin(),
+                                   node.properties.end(),
+                                   key,
+                                   [](Property const& a, std::string const& b) {
+                                       return a.key < b;
+                                   });
+        if (it != node.properties.end() && it->key == key)
+            return it->schema;
+        return node.additional;
+    }
+
+    // whole-value keywords, checked against the raw span of the value
+    std::optional<Schema_Error> check_whole(std::string_view span,
+                                            Node const& node,
+                                            std::string const& path,
+                                            size_t base) const
+    {
+        auto fail = [&](const char* message) {
+            return Schema_Error{ path, base, message };
+        };
+        auto passes = [&](uint32_t schema) {
+            std::string scratch = path;
+            return schema == any ||
+                   !check(span, schema, scratch, base, false).has_value();
+        };
+        if (node.enumeration || node.unique_items) {
+            JSON value = detail::schema_value(JSON::load(std::string(span)));
+            if (node.enumeration &&
+                std::find(node.enumeration->begin(),
+                          node.enumeration->end(),
+                          value) == node.enumeration->end())
+                return fail("Value is not one of the allowed values");
+            if (node.unique_items && value.JSON_type() == JSON::Class::Array) {
+                std::unordered_set<JSON, Hash> seen{};
+                for (auto& element : value.array_range())
+                    if (!seen.insert(element).second)
+                        return fail("Array items are not unique");
+            }
+        }
+        for (auto schema : node.all_of) {
+            std::string scratch = path;
+            if (schema != any)
+                if (auto error = check(span, schema, scratch, base, false))
+                    return error;
+        }
+        if (!node.any_of.empty() &&
+            std::none_of(node.any_of.begin(), node.any_of.end(), passes))
+            return fail("Value does not match any schema in anyOf");
+        if (!node.one_of.empty() &&
+            std::count_if(node.one_of.begin(), node.one_of.end(), passes) != 1)
+            return fail("Value does not match exactly one schema in oneOf");
+        if (node.negated != any && passes(node.negated))
+            return fail("Value matches the schema in not");
+        return std::nullopt;
+    }
+
+    std::optional<Schema_Error> check(std::string_view input,
+                                      uint32_t root,
+                                      std::string& path,
+                                      size_t base,
+                                      bool whole_done) const
+    {
+        detail::Tokenizer tokenizer(input);
+        std::vector<Frame> frames{};
+        auto fail = [&](std::string message) {
+            return Schema_Error{ path,
+                                 base + tokenizer.begin_offset(),
+                                 std::move(message) };
+        };
+        auto is_container = [](Token token) {
+            return token == Token::Begin_Object || token == Token::Begin_Array;
+        };
+
+        for (Token token = tokenizer.next();; token = tokenizer.next()) {
+            if (token == Token::End)
+                return std::nullopt;
+            if (token == Token::Error)
+                return fail(tokenizer.error());
+
+            if (token == Token::End_Object || token == Token::End_Array) {
+                Frame& frame = frames.back();
+                Node const& node = program_[frame.schema];
+                path.resize(frame.path_length);
+                if (frame.is_object) {
+                    for (size_t i = 0; i < node.required.size(); ++i)
+                        if (!frame.seen[i])
+                            return fail("Missing required property \"" +
+                                        node.required[i] + "\"");
+                    if (frame.count < node.min_properties)
+                        return fail("Too few properties");
+                } else if (frame.count < node.min_items) {
+                    return fail("Too few items");
+                }
+                frames.pop_back();
+                continue;
+            }
+
+            uint32_t schema = root;
+            if (!frames.empty()) {
+                Frame& frame = frames.back();
+                Node const& parent = program_[frame.schema];
+                path.resize(frame.path_length);
+                path += '/';
+                if (frame.is_object) {
+                    std::string key = detail::unquote(tokenizer.raw());
+                    for (char c : key)
+                        path += c == '~'   ? std::string("~0")
+                                : c == '/' ? std::string("~1")
+                                           : std::string(1, c);
+                    if (++frame.count > parent.max_properties)
+                        return fail("Too many properties");
+                    for (size_t i = 0; i < parent.required.size(); ++i)
+                        if (parent.required[i] == key)
+                            frame.seen[i] = true;
+                    schema = property(parent, key);
+                    token = tokenizer.next();
+                    if (token == Token::Error)
+                        return fail(tokenizer.error());
+                } else {
+                    path += std::to_string(frame.count);
+                    schema = frame.count < parent.prefix_items.size()
+                                 ? parent.prefix_items[frame.count]
+                                 : parent.items;
+                    if (++frame.count > parent.max_items)
+                        return fail("Too many items");
+                }
+            }
+
+            if (schema == any) {
+                if (is_container(token) && !tokenizer.skip())
+                    return fail(tokenizer.error());
+                continue;
+            }
+            Node const& node = program_[schema];
+            if (node.whole && !(whole_done && frames.empty())) {
+                size_t begin = tokenizer.begin_offset();
+                size_t end = is_container(token)
+                                 ? detail::skip_value(
+                                       input.data(), input.size(), begin)
+                                 : tokenizer.end_offset();
+                if (is_container(token) && !tokenizer.skip_to(end))
+                    return fail(tokenizer.error());
+                auto span = input.substr(begin, end - begin);
+                if (auto error = check_whole(span, node, path, base + begin))
+                    return error;
+                std::string scratch = path;
+                if (auto error =
+                        check(span, schema, scratch, base + begin, true))
+                    return error;
+                continue;
+            }
+
+            if (node.types == 0)
+                return fail("Value is not allowed");
+            switch (token) {
+                case Token::Begin_Object:
+                    if (!(node.types & Object))
+                        return fail("Unexpected object");
+                    frames.push_back(Frame{ schema,
+                                            true,
+                                            0,
+                                            path.size(),
+                                            std::vector<bool>(
+                                                node.required.size()) });
+                    break;
+                case Token::Begin_Array:
+                    if (!(node.types & Array))
+                        return fail("Unexpected array");
+                    frames.push_back(
+                        Frame{ schema, false, 0, path.size(), {} });
+                    break;
+                case Token::String: {
+                    if (!(node.types & String))
+                        return fail("Unexpected string");
+                    if (node.min_length == 0 && node.max_length == SIZE_MAX)
+                        break;
+                    size_t length = 0;
+                    for (char c : detail::unquote(tokenizer.raw()))
+                        length +=
+                            (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+                    if (length < node.min_length)
+                        return fail("String is too short");
+                    if (length > node.max_length)
+                        return fail("String is too long");
+                } break;
+                case Token::Number: {
+                    std::string raw(tokenizer.raw());
+                    double value = std::strtod(raw.c_str(), nullptr);
+                    bool integer = std::floor(value) == value;
+                    if (!(node.types & Number) &&
+                        !((node.types & Integer) && integer))
+                        return fail(node.types & Integer ? "Expected integer"
+                                                         : "Unexpected number");
+                    if (node.exclusive_minimum ? value <= node.minimum
+                                               : value < node.minimum)
+                        return fail("Number is below the minimum");
+                    if (node.exclusive_maximum ? value >= node.maximum
+                                               : value > node.maximum)
+                        return fail("Number is above the maximum");
+                    if (node.multiple_of > 0) {
+                        double quotient = value / node.multiple_of;
+                        if (std::floor(quotient) != quotient)
+                            return fail("Number is not a multiple of " +
+                                        std::to_string(node.multiple_of));
+                    }
+                } break;
+                case Token::Boolean:
+                    if (!(node.types & Boolean))
+                        return fail("Unexpected boolean");
+                    break;
+                case Token::Null:
+                    if (!(node.types & Null))
+                        return fail("Unexpected null");
+                    break;
+                default:
+                    return fail(tokenizer.error() ? tokenizer.error()
+                                                  : "Malformed input");
+            }
+        }
+    }
+
+    std::vector<Node> program_{};
+    std::vector<std::pair<std::string, uint32_t>> definitions_{};
+};
+
+///////////////////////
+// Frozen documents
+//////////////////////
+
+namespace detail {
+
+struct Static_Node
+{
+    JSON::Class type = JSON::Class::Null;
+    // decoded member key in the string table, for object members
+    uint32_t key = 0;
+    uint32_t key_length = 0;
+    // string value in the string table, the text of an integer beyond a
+    // long, or for a container its child count and, in snapshots, its
+    // first entry in the children index
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    // index one past this node's last descendant
+    uint32_t end = 0;
+    // booleans are stored as integral 0 or 1
+    union
+    {
+        long integral = 0;
+        double floating;
+    };
+};
+
+} // namespace detail
+
+// read-only view of one value in a flat node table
+class Static_View
+{
+  public:
+    constexpr Static_View(detail::Static_Node const* nodes,
+                          const char* strings,
+                          size_t index,
+                          uint32_t const* children = nullptr)
+        : nodes_(nodes)
+        , strings_(strings)
+        , index_(index)
+        , children_(children)
+    {
+    }
+
+    class iterator
+    {
+      public:
+        constexpr iterator(detail::Static_Node const* nodes,
+                           const char* strings,
+                           size_t index,
+                           uint32_t const* children)
+            : nodes_(nodes)
+            , strings_(strings)
+            , index_(index)
+            , children_(children)
+        {
+        }
+        constexpr Static_View operator*() const
+        {
+            return Static_View(nodes_, strings_, index_, children_);
+        }
+        constexpr iterator& operator++()
+        {
+            index_ = nodes_[index_].end;
+            return *this;
+        }
+        constexpr bool operator==(iterator const& other) const
+        {
+            return index_ == other.index_;
+        }
+        constexpr bool operator!=(iterator const& other) const
+        {
+            return !(*this == other);
+        }
+
+      private:
+        detail::Static_Node const* nodes_;
+        const char* strings_;
+        size_t index_;
+        uint32_t const* children_;
+    };
+
+    constexpr inline JSON::Class JSON_type() const noexcept
+    {
+        return valid() ? node().type : JSON::Class::Null;
+    }
+
+    constexpr inline bool is_null() const noexcept
+    {
+        return JSON_type() == JSON::Class::Null;
+    }
+
+    constexpr inline size_t size() const noexcept
+    {
+        return JSON_type() == JSON::Class::Object ||
+                       JSON_type() == JSON::Class::Array
+                   ? node().length
+                   : -1UL;
+    }
+
+    constexpr inline long to_int() const noexcept
+    {
+        return JSON_type() == JSON::Class::Integral ? node().integral : 0;
+    }
+
+    constexpr inline double to_float() const noexcept
+    {
+        return JSON_type() == JSON::Class::Floating ? node().floating : 0.0;
+    }
+
+    // number as decimal text, integers beyond a long as stored
+    inline std::string raw_number() const
+    {
+        if (JSON_type() == JSON::Class::Integral && node().length != 0)
+            return std::string(strings_ + node().offset, node().length);
+        if (JSON_type() == JSON::Class::Integral ||
+            JSON_type() == JSON::Class::Floating)
+            return to_json().raw_number();
+        return "";
+    }
+
+    constexpr inline bool to_bool() const noexcept
+    {
+        return JSON_type() == JSON::Class::Boolean && node().integral != 0;
+    }
+
+    constexpr inline std::string_view to_string() const noexcept
+    {
+        return JSON_type() == JSON::Class::String
+                   ? std::string_view(strings_ + node().offset, node().length)
+                   : std::string_view{};
+    }
+
+    // key of this value within its parent object
+    constexpr inline std::string_view key() const noexcept
+    {
+        return valid() ? std::string_view(strings_ + node().key,
+                                          node().key_length)
+                       : std::string_view{};
+    }
+
+    constexpr inline iterator begin() const noexcept
+    {
+        return iterator(nodes_, strings_, first_child(), children_);
+    }
+
+    constexpr inline iterator end() const noexcept
+    {
+        return iterator(
+            nodes_, strings_, valid() ? node().end : npos, children_);
+    }
+
+    constexpr Static_View operator[](std::string_view key) const noexcept
+    {
+        if (JSON_type() != JSON::Class::Object)
+            return Static_View(nodes_, strings_, npos, children_);
+        if (children_) {
+            // children sorted by key, first of any duplicates
+            uint32_t const* first = children_ + node().offset;
+            size_t count = node().length;
+            while (count > 0) {
+                size_t half = count / 2;
+                if (at(first[half]).key() < key) {
+                    first += half + 1;
+                    count -= half + 1;
+                } else {
+                    count = half;
+                }
+            }
+            if (first != children_ + node().offset + node().length &&
+                at(*first).key() == key)
+                return at(*first);
+        } else {
+            for (auto child : *this)
+                if (child.key() == key)
+                    return child;
+        }
+        return Static_View(nodes_, strings_, npos, children_);
+    }
+
+    constexpr Static_View operator[](size_t index) const noexcept
+    {
+        if (JSON_type() == JSON::Class::Array && index < size()) {
+            if (children_)
+                return at(children_[node().offset + index]);
+            auto it = begin();
+            while (index--)
+                ++it;
+            return *it;
+        }
+        return Static_View(nodes_, strings_, npos, children_);
+    }
+
+    constexpr inline bool has_key(std::string_view key) const noexcept
+    {
+        return JSON_type() == JSON::Class::Object && !(*this)[key].is_null();
+    }
+
+    // Materialize a mutable JSON copy at runtime
+    JSON to_json() const
+    {
+        switch (JSON_type()) {
+            case JSON::Class::Object: {
+                JSON obj = JSON::make(JSON::Class::Object);
+                for (auto child : *this)
+                    obj[detail::json_escape(std::string(child.key()))] =
+                        child.to_json();
+                return obj;
+            }
+            case JSON::Class::Array: {
+                JSON arr = JSON::make(JSON::Class::Array);
+                for (auto child : *this)
+                    arr.append(child.to_json());
+                return arr;
+            }
+            case JSON::Class::String:
+                return JSON(std::string(to_string()));
+            case JSON::Class::Floating:
+                return JSON(to_float());
+            case JSON::Class::Integral:
+                if (node().length != 0)
+                    return detail::number_text(raw_number(), false);
+                return JSON(to_int());
+            case JSON::Class::Boolean:
+                return JSON(to_bool());
+            default:
+                return JSON();
+        }
+    }
+
+  private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    constexpr inline bool valid() const noexcept { return index_ != npos; }
+
+    constexpr inline detail::Static_Node const& node() const noexcept
+    {
+        return nodes_[index_];
+    }
+
+    constexpr inline size_t first_child() const noexcept
+    {
+        return JSON_type() == JSON::Class::Object ||
+                       JSON_type() == JSON::Class::Array
+                   ? index_ + 1
+                   : (valid() ? node().end : npos);
+    }
+
+    constexpr inline Static_View at(size_t index) const noexcept
+    {
+        return Static_View(nodes_, strings_, index, children_);
+    }
+
+    detail::Static_Node const* nodes_;
+    const char* strings_;
+    size_t index_;
+    // per container, child node indices from node().offset: sorted by key
+    // for objects and in order for arrays
+    uint32_t const* children_;
+};
+
+// deeply immutable document, safe to read from many threads
+class Frozen_Document
+{
+  public:
+    // a frozen null
+    Frozen_Document()
+        : nodes_(1)
+    {
+        nodes_.front().end = 1;
+    }
+
+    inline Static_View root() const noexcept
+    {
+        return Static_View(nodes_.data(), strings_.data(), 0);
+    }
+    inline Static_View operator[](std::string_view key) const noexcept
+    {
+        return root()[key];
+    }
+    inline Static_View operator[](size_t index) const noexcept
+    {
+        return root()[index];
+    }
+    inline JSON::Class JSON_type() const noexcept
+    {
+        return root().JSON_type();
+    }
+    inline bool is_null() const noexcept { return root().is_null(); }
+    inline size_t size() const noexcept { return root().size(); }
+    inline JSON to_json() const { return root().to_json(); }
+
+    // bytes held by the node and string tables
+    inline size_t memory_usage() const noexcept
+    {
+        return nodes_.capacity() * sizeof(detail::Static_Node) +
+               strings_.capacity();
+    }
+
+    // tables in the snapshot format read by Mapped_Document
+    std::vector<char> snapshot() const;
+
+    // write snapshot() to a file, false if it cannot be written
+    inline bool save(std::string_view path) const
+    {
+        Snapshot_Error error{};
+        return save(path, error);
+    }
+    bool save(std::string_view path, Snapshot_Error& error) const;
+
+  private:
+    friend class JSON;
+    friend class Parser;
+
+    // vectors keep their buffers on move, so views stay valid
+    std::vector<detail::Static_Node> nodes_{};
+    std::vector<char> strings_{};
+};
+
+inline Frozen_Document JSON::freeze() const
+{
+    struct Visitor
+    {
+        std::vector<detail::Static_Node>& nodes;
+        std::vector<char>& strings;
+        std::vector<size_t> parents{};
+
+        inline std::pair<uint32_t, uint32_t> store(std::string_view text)
+        {
+            auto offset = static_cast<uint32_t>(strings.size());
+            strings.insert(strings.end(), text.begin(), text.end());
+            return { offset, static_cast<uint32_t>(text.size()) };
+        }
+        bool enter(JSON const& value, detail::JSON_String const* key)
+        {
+            detail::Static_Node node{};
+            node.type = value.JSON_type();
+            if (key) {
+                // object keys are held escaped, the table holds them decoded
+                auto [offset, length] =
+                    store(key->find('\\') == key->npos
+                              ? std::string(*key)
+                              : detail::unquote("\"" + std::string(*key) +
+                                                "\""));
+                node.key = offset;
+                node.key_length = length;
+            }
+            if (!parents.empty())
+                ++nodes[parents.back()].length;
+            switch (node.type) {
+                case Class::Object:
+                case Class::Array:
+                    parents.push_back(nodes.size());
+                    break;
+                case Class::String: {
+                    auto [offset, length] = store(value.text());
+                    node.offset = offset;
+                    node.length = length;
+                } break;
+                case Class::Floating:
+                    node.floating = value.to_float();
+                    break;
+                case Class::Integral:
+                    if (!value.integral(node.integral)) {
+                        auto [offset, length] = store(value.raw_number());
+                        node.offset = offset;
+                        node.length = length;
+                    }
+                    break;
+                case Class::Boolean:
+                    node.integral = value.to_bool();
+                    break;
+                default:
+                    break;
+            }
+            node.end = static_cast<uint32_t>(nodes.size() + 1);
+            nodes.push_back(node);
+            return true;
+        }
+        // only containers are left
+        void leave(JSON const&)
+        {
+            nodes[parents.back()].end = static_cast<uint32_t>(nodes.size());
+            parents.pop_back();
+        }
+    };
+
+    Frozen_Document frozen{};
+    frozen.nodes_.clear();
+    Visitor visitor{ frozen.nodes_, frozen.strings_ };
+    walk(*this, visitor);
+    frozen.nodes_.shrink_to_fit();
+    frozen.strings_.shrink_to_fit();
+    return frozen;
+}
+
+///////////////////////
+// Mapped documents
+//////////////////////
+
+namespace detail {
+
+// snapshot file header, followed by the node, index and string tables
+struct Snapshot_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_size;
+    uint32_t reserved;
+    uint64_t node_count;
+    uint64_t child_count;
+    uint64_t string_size;
+    uint64_t padding[2];
+};
+
+static_assert(sizeof(Snapshot_Header) == 64, "snapshot header is 64 bytes");
+
+inline constexpr char snapshot_magic[8] = { 'S', 'J', 'S', 'N',
+                                            'A', 'P', '\0', '\0' };
+inline constexpr uint32_t snapshot_version = 1;
+inline constexpr uint32_t snapshot_byte_order = 0x01020304;
+
+} // namespace detail
+
+inline std::vector<char> Frozen_Document::snapshot() const
+{
+    std::vector<detail::Static_Node> nodes(nodes_);
+    std::vector<uint32_t> children{};
+    children.reserve(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        auto& node = nodes[i];
+        if (node.type != JSON::Class::Object &&
+            node.type != JSON::Class::Array)
+            continue;
+        node.offset = static_cast<uint32_t>(children.size());
+        for (size_t child = i + 1; child < node.end; child = nodes[child].end)
+            children.push_back(static_cast<uint32_t>(child));
+        if (node.type == JSON::Class::Object) {
+            auto key = [&](uint32_t child) {
+                return std::string_view(strings_.data() + nodes[child].key,
+                                        nodes[child].key_length);
+            };
+            std::stable_sort(children.begin() + node.offset,
+                             children.end(),
+                             [&](uint32_t a, uint32_t b) {
+                                 return key(a) < key(b);
+                             });
+        }
+    }
+
+    detail::Snapshot_Header header{};
+    std::memcpy(header.magic, detail::snapshot_magic, sizeof(header.magic));
+    header.version = detail::snapshot_version;
+    header.byte_order = detail::snapshot_byte_order;
+    header.node_size = sizeof(detail::Static_Node);
+    header.node_count = nodes.size();
+    header.child_count = children.size();
+    header.string_size = strings_.size();
+
+    size_t node_bytes = nodes.size() * sizeof(detail::Static_Node);
+    size_t child_bytes = children.size() * sizeof(uint32_t);
+    std::vector<char> out(sizeof(header) + node_bytes + child_bytes +
+                          strings_.size());
+    char* cursor = out.data();
+    std::memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    std::memcpy(cursor, nodes.data(), node_bytes);
+    cursor += node_bytes;
+    if (child_bytes > 0)
+        std::memcpy(cursor, children.data(), child_bytes);
+    cursor += child_bytes;
+    if (!strings_.empty())
+        std::memcpy(cursor, strings_.data(), strings_.size());
+    return out;
+}
+
+inline bool Frozen_Document::save(std::string_view path,
+                                  Snapshot_Error& error) const
+{
+    error = Snapshot_Error{};
+    auto bytes = snapshot();
+    std::ofstream f(std::string(path), std::ios::out | std::ios::binary);
+    f.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!f) {
+        error.code = Snapshot_Error::Code::cannot_write;
+        return false;
+    }
+    return true;
+}
+
+inline bool JSON::save_snapshot(std::string_view path) const
+{
+    return freeze().save(path);
+}
+
+inline bool JSON::save_snapshot(std::string_view path,
+                                Snapshot_Error& error) const
+{
+    return freeze().save(path, error);
+}
+
+// read-only document over a memory-mapped snapshot file
+class Mapped_Document
+{
+  public:
+    static std::optional<Mapped_Document> open(std::string_view path)
+    {
+        Snapshot_Error error{};
+        return open(path, error);
+    }
+
+    // As open(path), with the reason for an empty result in error
+    static std::optional<Mapped_Document> open(std::string_view path,
+                                               Snapshot_Error& error)
+    {
+        error = Snapshot_Error{};
+        std::string name(path);
+        std::shared_ptr<const char> data{};
+        size_t size = 0;
+#ifdef SIMPLEJSON_MMAP
+        int fd = ::open(name.c_str(), O_RDONLY);
+        struct stat info = {};
+        if (fd >= 0 && ::fstat(fd, &info) == 0 && info.st_size > 0) {
+            size = static_cast<size_t>(info.st_size);
+            void* mapped =
+                ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            if (mapped != MAP_FAILED)
+                data = std::shared_ptr<const char>(
+                    static_cast<const char*>(mapped),
+                    [size](const char* p) {
+                        ::munmap(const_cast<char*>(p), size);
+                    });
+        }
+        if (fd >= 0)
+            ::close(fd);
+#else
+        std::ifstream f(name, std::ios::in | std::ios::binary);
+        if (f) {
+            f.seekg(0, std::ios::end);
+            size = static_cast<size_t>(f.tellg());
+            f.seekg(0, std::ios::beg);
+            char* buffer = new char[size];
+            data = std::shared_ptr<const char>(
+                buffer, [](const char* p) { delete[] p; });
+            if (!f.read(buffer, static_cast<std::streamsize>(size)))
+                data.reset();
+        }
+#endif
+        if (!data) {
+            error.code = Snapshot_Error::Code::cannot_read;
+            return std::nullopt;
+        }
+        return adopt(std::move(data), size, error);
+    }
+
+    // view over an 8-byte aligned snapshot already in memory
+    static std::optional<Mapped_Document> view(void const* data, size_t size)
+    {
+        Snapshot_Error error{};
+        return view(data, size, error);
+    }
+
+    static std::optional<Mapped_Document> view(void const* data,
+                                               size_t size,
+                                               Snapshot_Error& error)
+    {
+        error = Snapshot_Error{};
+        return adopt(std::shared_ptr<const char>(
+                         static_cast<const char*>(data), [](const char*) {}),
+                     size,
+                     error);
+    }
+
+    inline Static_View root() const noexcept
+    {
+        return Static_View(nodes_, strings_, 0, children_);
+    }
+    inline Static_View operator[](std::string_view key) const noexcept
+    {
+        return root()[key];
+    }
+    inline Static_View operator[](size_t index) const noexcept
+    {
+        return root()[index];
+    }
+    inline JSON::Class JSON_type() const noexcept
+    {
+        return root().JSON_type();
+    }
+    inline bool is_null() const noexcept { return root().is_null(); }
+    inline size_t size() const noexcept { return root().size(); }
+    inline JSON to_json() const { return root().to_json(); }
 
-namespace json {
+  private:
+    Mapped_Document() = default;
 
-class JSON;
+    static std::optional<Mapped_Document> adopt(
+        std::shared_ptr<const char> data,
+        size_t size,
+        Snapshot_Error& error)
+    {
+        using Code = Snapshot_Error::Code;
+        auto invalid = [&](Code code) {
+            error.code = code;
+            return std::nullopt;
+        };
+        detail::Snapshot_Header header{};
+        if (size < sizeof(header))
+            return invalid(Code::truncated);
+        std::memcpy(&header, data.get(), sizeof(header));
+        if (std::memcmp(header.magic,
+                        detail::snapshot_magic,
+                        sizeof(header.magic)) != 0)
+            return invalid(Code::not_a_snapshot);
+        if (header.version != detail::snapshot_version ||
+            header.byte_order != detail::snapshot_byte_order ||
+            header.node_size != sizeof(detail::Static_Node))
+            return invalid(Code::incompatible);
+        if (reinterpret_cast<uintptr_t>(data.get()) %
+                alignof(detail::Static_Node) !=
+            0)
+            return invalid(Code::misaligned);
 
-namespace detail {
+        // checked piecewise so corrupt counts cannot overflow
+        size_t left = size - sizeof(header);
+        if (header.node_count == 0 ||
+            header.node_count > left / sizeof(detail::Static_Node))
+            return invalid(Code::truncated);
+        left -= header.node_count * sizeof(detail::Static_Node);
+        if (header.child_count > left / sizeof(uint32_t))
+            return invalid(Code::truncated);
+        left -= header.child_count * sizeof(uint32_t);
+        if (header.string_size != left)
+            return invalid(Code::truncated);
 
-using JSON_Deque = std::deque<JSON>;
-using JSON_String = std::string;
-using JSON_Map = std::map<std::string, JSON>;
-using JSON_Deque_PTR = std::shared_ptr<JSON_Deque>;
-using JSON_String_PTR = std::shared_ptr<JSON_String>;
-using JSON_Map_PTR = std::shared_ptr<JSON_Map>;
+        Mapped_Document document{};
+        const char* cursor = data.get() + sizeof(header);
+        document.nodes_ =
+            reinterpret_cast<detail::Static_Node const*>(cursor);
+        cursor += header.node_count * sizeof(detail::Static_Node);
+        document.children_ = reinterpret_cast<uint32_t const*>(cursor);
+        cursor += header.child_count * sizeof(uint32_t);
+        document.strings_ = cursor;
+        if (document.nodes_[0].end != header.node_count ||
+            !well_formed(document.nodes_,
+                         header.node_count,
+                         document.children_,
+                         header.child_count,
+                         header.string_size))
+            return invalid(Code::corrupt);
+        document.data_ = std::move(data);
+        return document;
+    }
 
-template<typename T>
-inline constexpr bool is_Object_Variant =
-    std::is_same_v<T, JSON_Deque> || std::is_same_v<T, JSON_String> ||
-    std::is_same_v<T, JSON_Map>;
+    // Every offset and length within its table, containers nested in
+    // their parents and children indices pointing at their own children,
+    // so that no lookup or iteration can leave the tables
+    static bool well_formed(detail::Static_Node const* nodes,
+                            size_t node_count,
+                            uint32_t const* children,
+                            size_t child_count,
+                            size_t string_size)
+    {
+        using Class = JSON::Class;
+        auto within = [](uint64_t offset, uint64_t length, uint64_t size) {
+            return offset <= size && length <= size - offset;
+        };
+        struct Open
+        {
+            size_t index;
+            size_t count;
+        };
+        std::vector<Open> open{};
+        auto close = [&] {
+            auto const& last = open.back();
+            bool complete = last.count == nodes[last.index].length;
+            open.pop_back();
+            return complete;
+        };
+        for (size_t i = 0; i < node_count; ++i) {
+            while (!open.empty() && nodes[open.back().index].end == i)
+                if (!close())
+                    return false;
+            auto const& node = nodes[i];
+            size_t limit =
+                open.empty() ? node_count : nodes[open.back().index].end;
+            if (node.end <= i || node.end > limit ||
+                !within(node.key, node.key_length, string_size))
+                return false;
+            if (!open.empty()) {
+                auto& parent = open.back();
+                auto const& container = nodes[parent.index];
+                if (parent.count == container.length ||
+                    (container.type == Class::Array &&
+                     children[container.offset + parent.count] != i))
+                    return false;
+                ++parent.count;
+            }
+            switch (node.type) {
+                case Class::Object:
+                case Class::Array:
+                    if (!within(node.offset, node.length, child_count))
+                        return false;
+                    for (size_t k = 0; k < node.length; ++k) {
+                        uint32_t child = children[node.offset + k];
+                        if (child <= i || child >= node.end)
+                            return false;
+                    }
+                    open.push_back({ i, 0 });
+                    break;
+                case Class::String:
+                case Class::Integral:
+                    if (!within(node.offset, node.length, string_size))
+                        return false;
+                    [[fallthrough]];
+                case Class::Null:
+                case Class::Floating:
+                case Class::Boolean:
+                    if (node.end != i + 1)
+                        return false;
+                    break;
+                default:
+                    return false;
+            }
+        }
+        while (!open.empty())
+            if (!close())
+                return false;
+        return true;
+    }
 
-template<typename T>
-inline constexpr bool is_Object_Variant_Pointer =
-    std::is_same_v<T, JSON_Deque_PTR> || std::is_same_v<T, JSON_String_PTR> ||
-    std::is_same_v<T, JSON_Map_PTR>;
+    std::shared_ptr<const char> data_{};
+    detail::Static_Node const* nodes_ = nullptr;
+    uint32_t const* children_ = nullptr;
+    const char* strings_ = nullptr;
+};
+
+///////////////////////
+// Reusable parser
+//////////////////////
+
+namespace detail {
 
-template<typename Type, typename = std::enable_if_t<is_Object_Variant<Type>>>
-inline std::shared_ptr<Type> make_data_object(Type const& obj)
+// Append a quoted token's decoded contents to out; on failure error has
+// the code and the offset into raw
+template<typename Buffer>
+bool append_unquoted(std::string_view raw,
+                     std::string& scratch,
+                     Buffer& out,
+                     Parse_Error& error)
 {
-    return std::make_shared<Type>(obj);
+    std::string_view body = raw.substr(1, raw.size() - 2);
+    if (body.find('\\') == std::string_view::npos) {
+        size_t bad = validate_utf8(body.data(), body.size());
+        if (bad != std::string_view::npos) {
+            fail(error, Parse_Error::Code::invalid_utf8, 1 + bad);
+            return false;
+        }
+        out.insert(out.end(), body.begin(), body.end());
+        return true;
+    }
+    // decoded straight into out, the scratch copy only adds the sentinel
+    scratch.assign(raw.data(), raw.size());
+    size_t position = 0;
+    return decode_string(scratch, position, error, out);
 }
 
-template<typename Type>
-Type get_safe_data_object(std::optional<std::shared_ptr<Type>> const& type);
+// How a number token is held: integers in a long, or as their text when
+// they do not fit one, as JSON::load keeps them; others as a double
+enum class Token_Number
+{
+    integral,
+    floating,
+    text
+};
 
-#if __cplusplus >= 202002L
-constexpr inline std::string json_escape(std::string const& str)
-#else
-inline std::string json_escape(std::string const& str)
-#endif
+inline Token_Number token_number(std::string_view raw,
+                                 std::string& scratch,
+                                 long& integral,
+                                 double& floating)
 {
-    std::string output;
-    for (unsigned i = 0; i < str.length(); ++i)
-        switch (str[i]) {
-            case '\"':
-                output += "\\\"";
-                break;
-            case '\\':
-                output += "\\\\";
-                break;
-            case '\b':
-                output += "\\b";
-                break;
-            case '\f':
-                output += "\\f";
-                break;
-            case '\n':
-                output += "\\n";
-                break;
-            case '\r':
-                output += "\\r";
-                break;
-            case '\t':
-                output += "\\t";
-                break;
-            default:
-                output += str[i];
-                break;
-        }
-    return output;
+    if (raw.find_first_of(".eE") == std::string_view::npos) {
+        auto [end, status] =
+            std::from_chars(raw.data(), raw.data() + raw.size(), integral);
+        return status == std::errc() && end == raw.data() + raw.size()
+                   ? Token_Number::integral
+                   : Token_Number::text;
+    }
+    scratch.assign(raw.data(), raw.size());
+    floating = std::strtod(scratch.c_str(), nullptr);
+    return Token_Number::floating;
 }
 
 } // namespace detail
 
-class JSON
+// parser reusing its scratch buffers between calls, one per thread
+class Parser
 {
   public:
-    enum class Class
-    {
-        Null,
-        Object,
-        Array,
-        String,
-        Floating,
-        Integral,
-        Boolean
-    };
+    using Token = detail::Tokenizer::Token;
 
-  public:
-  public:
-    JSON()
-        : Internal()
-        , Type(Class::Null)
+    explicit Parser(Options const& options = Options{})
+        : options_(options)
     {
     }
-    explicit JSON(std::initializer_list<JSON> list)
-        : JSON()
+
+    // result stays valid until the next call, null on malformed input
+    inline Frozen_Document const& parse(std::string_view input)
     {
-        set_type(Class::Object);
-        for (auto const& i : list) {
-            this->operator[](i.to_string()) = i;
-        }
+        Parse_Error error{};
+        return parse(input, error);
     }
 
-    explicit JSON(detail::JSON_Deque const& list)
-        : JSON()
+    // As parse(input), with the reason for a null result in error
+    Frozen_Document const& parse(std::string_view input, Parse_Error& error)
     {
-        set_type(Class::Array);
-        for (auto const& i : list) {
-            append(i);
+        using Code = Parse_Error::Code;
+        error = Parse_Error{};
+        auto& nodes = document_.nodes_;
+        auto& strings = document_.strings_;
+        nodes.clear();
+        strings.clear();
+        parents_.clear();
+        tokenizer_.reset(input);
+        keyed_ = false;
+
+        for (Token token = tokenizer_.next(); token != Token::End;
+             token = tokenizer_.next()) {
+            detail::Static_Node node{};
+            switch (token) {
+                case Token::Key:
+                    if (!store(tokenizer_.raw(), key_, key_length_, error))
+                        return fail(input, error, error.code, error.offset);
+                    keyed_ = true;
+                    continue;
+                case Token::End_Object:
+                case Token::End_Array:
+                    nodes[parents_.back()].end =
+                        static_cast<uint32_t>(nodes.size());
+                    parents_.pop_back();
+                    continue;
+                case Token::Begin_Object:
+                case Token::Begin_Array:
+                    if (parents_.size() >= options_.max_depth)
+                        return fail(input, error, Code::max_depth);
+                    node.type = token == Token::Begin_Object
+                                    ? JSON::Class::Object
+                                    : JSON::Class::Array;
+                    break;
+                case Token::String:
+                    if (!store(
+                            tokenizer_.raw(), node.offset, node.length, error))
+                        return fail(input, error, error.code, error.offset);
+                    node.type = JSON::Class::String;
+                    break;
+                case Token::Number:
+                    number(tokenizer_.raw(), node);
+                    break;
+                case Token::Boolean:
+                    node.type = JSON::Class::Boolean;
+                    node.integral = tokenizer_.raw()[0] == 't';
+                    break;
+                case Token::Null:
+                    break;
+                default:
+                    return fail(input, error, tokenizer_.error_code());
+            }
+            keyed_ = false;
+            if (!parents_.empty()) {
+                auto& parent = nodes[parents_.back()];
+                ++parent.length;
+                if (parent.type == JSON::Class::Object) {
+                    node.key = key_;
+                    node.key_length = key_length_;
+                }
+            }
+            node.end = static_cast<uint32_t>(nodes.size() + 1);
+            if (token == Token::Begin_Object || token == Token::Begin_Array)
+                parents_.push_back(nodes.size());
+            nodes.push_back(node);
         }
+        // End stops after the whitespace that follows the value
+        if (tokenizer_.offset() != input.size())
+            return fail(input, error, Code::trailing_content);
+        return document_;
     }
 
-    explicit JSON(JSON&& other)
-        : Internal(std::move(other.Internal))
-        , Type(std::move(other.Type))
+  private:
+    // offset is from the start of the token that failed
+    inline Frozen_Document const& fail(std::string_view input,
+                                       Parse_Error& error,
+                                       Parse_Error::Code code,
+                                       size_t offset = 0)
     {
+        error.code = code;
+        error.offset = tokenizer_.begin_offset() + offset;
+        error.locate(input);
+        error.pointer = pointer();
+        document_.nodes_.assign(1, detail::Static_Node{});
+        document_.nodes_.front().end = 1;
+        return document_;
     }
-    JSON const& operator=(JSON&& other)
+
+    // JSON pointer of the value being parsed when an error stopped it
+    std::string pointer() const
     {
-        if (this != &other) {
-            Internal = std::move(other.Internal);
-            Type = std::move(other.Type);
+        auto const& nodes = document_.nodes_;
+        auto const& strings = document_.strings_;
+        std::string pointer{};
+        for (size_t i = 0; i < parents_.size(); ++i) {
+            auto const& parent = nodes[parents_[i]];
+            bool innermost = i + 1 == parents_.size();
+            if (parent.type == JSON::Class::Array) {
+                pointer += '/';
+                pointer += std::to_string(parent.length - !innermost);
+                continue;
+            }
+            if (innermost && !keyed_)
+                break;
+            uint32_t key = innermost ? key_ : nodes[parents_[i + 1]].key;
+            uint32_t length =
+                innermost ? key_length_ : nodes[parents_[i + 1]].key_length;
+            pointer += '/';
+            for (size_t c = 0; c < length; ++c) {
+                char ch = strings[key + c];
+                if (ch == '~' || ch == '/')
+                    pointer += ch == '~' ? "~0" : "~1";
+                else
+                    pointer += ch;
+            }
         }
-        return *this;
+        return pointer;
     }
-    JSON(const JSON& other)
-        : Internal(other.Internal)
-        , Type(other.Type)
+
+    // append a quoted token's decoded contents to the string table
+    inline bool store(std::string_view raw,
+                      uint32_t& offset,
+                      uint32_t& length,
+                      Parse_Error& error)
     {
+        auto& strings = document_.strings_;
+        offset = static_cast<uint32_t>(strings.size());
+        if (!detail::append_unquoted(raw, scratch_, strings, error))
+            return false;
+        length = static_cast<uint32_t>(strings.size()) - offset;
+        return true;
     }
 
-    JSON& operator=(const JSON& other)
+    inline void number(std::string_view raw, detail::Static_Node& node)
     {
-        if (this == &other) {
-            return *this;
+        using Kind = detail::Token_Number;
+        long integral = 0;
+        double floating = 0;
+        switch (detail::token_number(raw, scratch_, integral, floating)) {
+            case Kind::integral:
+                node.type = JSON::Class::Integral;
+                node.integral = integral;
+                break;
+            case Kind::floating:
+                node.type = JSON::Class::Floating;
+                node.floating = floating;
+                break;
+            case Kind::text: {
+                // kept in the string table, as JSON::freeze does
+                auto& strings = document_.strings_;
+                node.type = JSON::Class::Integral;
+                node.offset = static_cast<uint32_t>(strings.size());
+                node.length = static_cast<uint32_t>(raw.size());
+                strings.insert(strings.end(), raw.begin(), raw.end());
+            } break;
         }
-        Internal = other.Internal;
-        Type = other.Type;
-        return *this;
     }
 
-#ifdef CATCH2_TEST_BUILD
-    inline operator std::string() const { return dump(); }
-#endif
+    Options options_;
+    detail::Tokenizer tokenizer_{ std::string_view{} };
+    std::vector<size_t> parents_{};
+    std::string scratch_{};
+    Frozen_Document document_{};
+    // the key of the member being parsed, and whether one was read
+    uint32_t key_ = 0;
+    uint32_t key_length_ = 0;
+    bool keyed_ = false;
+};
 
-    template<typename T>
-    explicit JSON(
-        T b,
-        typename std::enable_if<std::is_same<T, bool>::value>::type* = nullptr)
-        : Internal(b)
-        , Type(Class::Boolean)
-    {
-    }
+///////////////////////
+// Tape documents
+//////////////////////
 
-    template<typename T>
-    explicit JSON(
-        T i,
-        typename std::enable_if<std::is_integral<T>::value &&
-                                !std::is_same<T, bool>::value>::type* = nullptr)
-        : Internal(static_cast<long>(i))
-        , Type(Class::Integral)
-    {
-    }
+namespace detail {
 
-    template<typename T>
-    explicit JSON(
-        T f,
-        typename std::enable_if<std::is_floating_point<T>::value>::type* =
-            nullptr)
-        : Internal(static_cast<double>(f))
-        , Type(Class::Floating)
-    {
+// tape entries: an 8-bit tag over a 56-bit payload; strings ('"') and
+// integers beyond a long ('L') point at their text in the string buffer
+namespace tape {
+
+inline constexpr uint64_t payload_mask = (uint64_t{ 1 } << 56) - 1;
+inline constexpr uint64_t count_limit = 0xffffff;
+
+constexpr inline uint64_t entry(char tag, uint64_t payload = 0) noexcept
+{
+    return static_cast<uint64_t>(static_cast<uint8_t>(tag)) << 56 | payload;
+}
+
+constexpr inline char tag(uint64_t entry) noexcept
+{
+    return static_cast<char>(entry >> 56);
+}
+
+// index of the value after the one starting at index
+constexpr inline size_t next(uint64_t const* tape, size_t index) noexcept
+{
+    switch (tag(tape[index])) {
+        case '{':
+        case '[':
+            return static_cast<uint32_t>(tape[index]);
+        case 'l':
+        case 'd':
+            return index + 2;
+        default:
+            return index + 1;
     }
+}
 
-    template<typename T>
-    explicit JSON(
-        T s,
-        typename std::enable_if<
-            std::is_convertible<T, std::string>::value>::type* = nullptr)
-        : Internal(std::string(s))
-        , Type(Class::String)
+} // namespace tape
+
+} // namespace detail
+
+// cursor into a Tape_Document, lookups never insert
+class Tape_View
+{
+  public:
+    constexpr Tape_View(uint64_t const* tape, const char* strings, size_t index)
+        : tape_(tape)
+        , strings_(strings)
+        , index_(index)
     {
     }
 
-  private:
-    // internal STL-container
-    struct internal
+    // (key, value) pairs for objects, values for arrays
+    template<bool Members>
+    class Range
     {
-        explicit internal(long i)
-            : data_{ i }
-        {
-        }
-        explicit internal(double i)
-            : data_{ i }
-        {
-        }
-        explicit internal(bool i)
-            : data_{ i }
+      public:
+        class iterator
         {
-        }
-        explicit internal(std::string const& i)
-            : String(detail::make_data_object<detail::JSON_String>(i))
+          public:
+            constexpr iterator(uint64_t const* tape,
+                               const char* strings,
+                               size_t index)
+                : tape_(tape)
+                , strings_(strings)
+                , index_(index)
+            {
+            }
+            constexpr auto operator*() const
+            {
+                if constexpr (Members)
+                    return std::pair<std::string_view, Tape_View>(
+                        Tape_View(tape_, strings_, index_).to_string(),
+                        Tape_View(tape_, strings_, index_ + 1));
+                else
+                    return Tape_View(tape_, strings_, index_);
+            }
+            constexpr iterator& operator++()
+            {
+                index_ = detail::tape::next(tape_, index_ + Members);
+                return *this;
+            }
+            constexpr bool operator==(iterator const& other) const
+            {
+                return index_ == other.index_;
+            }
+            constexpr bool operator!=(iterator const& other) const
+            {
+                return !(*this == other);
+            }
+
+          private:
+            uint64_t const* tape_;
+            const char* strings_;
+            size_t index_;
+        };
+
+        constexpr Range(uint64_t const* tape,
+                        const char* strings,
+                        size_t first,
+                        size_t last)
+            : tape_(tape)
+            , strings_(strings)
+            , first_(first)
+            , last_(last)
         {
         }
-        internal() = default;
-        std::optional<detail::JSON_Deque_PTR> List;
-        std::optional<detail::JSON_String_PTR> String;
-        std::optional<detail::JSON_Map_PTR> Map;
-        std::variant<std::monostate, long, double, bool> data_ =
-            std::monostate();
+
+        constexpr iterator begin() const { return { tape_, strings_, first_ }; }
+        constexpr iterator end() const { return { tape_, strings_, last_ }; }
+
+      private:
+        uint64_t const* tape_;
+        const char* strings_;
+        size_t first_;
+        size_t last_;
     };
 
-  public:
-    mutable internal Internal{};
-    inline friend std::ostream& operator<<(std::ostream& os, const JSON& json)
+    constexpr inline JSON::Class JSON_type() const noexcept
     {
-        os << json.dump();
-        return os;
+        switch (valid() ? detail::tape::tag(word()) : 'n') {
+            case '{':
+                return JSON::Class::Object;
+            case '[':
+                return JSON::Class::Array;
+            case '"':
+                return JSON::Class::String;
+            case 'l':
+            case 'L':
+                return JSON::Class::Integral;
+            case 'd':
+                return JSON::Class::Floating;
+            case 't':
+            case 'f':
+                return JSON::Class::Boolean;
+            default:
+                return JSON::Class::Null;
+        }
     }
 
-    template<typename Type,
-             typename = std::enable_if<detail::is_Object_Variant<Type>>>
-    friend std::optional<std::shared_ptr<Type>> make_data_object()
+    constexpr inline bool is_null() const noexcept
     {
-        if constexpr (std::is_same_v<Type, detail::JSON_Map>) {
-            return std::make_shared<Type>(std::map<std::string, JSON>{});
-        } else if constexpr (std::is_same_v<Type, detail::JSON_String>) {
-            return std::make_shared<Type>(std::string{});
-        } else if constexpr (std::is_same_v<Type, detail::JSON_Deque>) {
-            return std::make_shared<detail::JSON_Deque>(std::deque<JSON>{});
-        } else {
-            return std::make_shared<Type>(std::map<std::string, JSON>{});
-        }
+        return JSON_type() == JSON::Class::Null;
     }
 
-    bool operator==(JSON const& other) const
+    constexpr inline size_t size() const noexcept
     {
-        switch (other.Type) {
-            case Class::Null:
-                return this->is_null() == other.is_null();
-                break;
-            case Class::Object: {
-                auto lhs = detail::get_safe_data_object(Internal.Map);
-                auto rhs = detail::get_safe_data_object<detail::JSON_Map>(
-                    other.Internal.Map);
-                return lhs == rhs;
+        if (!is_container())
+            return -1UL;
+        size_t count = (word() & detail::tape::payload_mask) >> 32;
+        if (count < detail::tape::count_limit)
+            return count;
+        // counts past the limit are recovered by walking the container
+        count = 0;
+        for (size_t i = index_ + 1; i < close(); ++count)
+            i = detail::tape::next(
+                tape_, JSON_type() == JSON::Class::Object ? i + 1 : i);
+        return count;
+    }
 
-            } break;
-            case Class::Array: {
-                auto lhs = detail::get_safe_data_object<detail::JSON_Deque>(
-                    Internal.List);
-                auto rhs = detail::get_safe_data_object<detail::JSON_Deque>(
-                    other.Internal.List);
+    // 0 for integers that do not fit a long, see raw_number
+    inline long to_int() const noexcept
+    {
+        if (!valid() || detail::tape::tag(word()) != 'l')
+            return 0;
+        long value = 0;
+        std::memcpy(&value, tape_ + index_ + 1, sizeof(value));
+        return value;
+    }
 
-                return lhs == rhs;
-            } break;
-            case Class::String: {
-                auto lhs = *(Internal.String.value_or(
-                    detail::make_data_object<detail::JSON_String>(
-                        make_empty_string())));
-                auto rhs = *(other.Internal.String.value_or(
-                    detail::make_data_object<detail::JSON_String>(
-                        make_empty_string())));
-
-                return lhs == rhs;
-            } break;
-            case Class::Floating:
-            case Class::Integral:
-            case Class::Boolean:
-                return this->Internal.data_ == other.Internal.data_;
-                break;
-        }
-        return false;
+    inline double to_float() const noexcept
+    {
+        if (JSON_type() != JSON::Class::Floating)
+            return 0.0;
+        double value = 0;
+        std::memcpy(&value, tape_ + index_ + 1, sizeof(value));
+        return value;
+    }
+
+    // number as decimal text, integers beyond a long as stored
+    inline std::string raw_number() const
+    {
+        if (valid() && detail::tape::tag(word()) == 'L')
+            return std::string(text());
+        if (JSON_type() == JSON::Class::Integral)
+            return std::to_string(to_int());
+        if (JSON_type() == JSON::Class::Floating)
+            return to_json().raw_number();
+        return "";
     }
 
-    bool inline operator!=(JSON const& rhs) { return !(this->operator==(rhs)); }
+    constexpr inline bool to_bool() const noexcept
+    {
+        return valid() && detail::tape::tag(word()) == 't';
+    }
 
-    inline std::map<std::string, JSON> make_empty_map() const noexcept
+    inline std::string_view to_string() const noexcept
     {
-        return std::map<std::string, JSON>{};
+        if (JSON_type() != JSON::Class::String)
+            return {};
+        return text();
     }
 
-    inline std::deque<JSON> make_empty_list() const noexcept
+    inline Tape_View operator[](std::string_view key) const noexcept
     {
-        return std::deque<JSON>{};
+        if (JSON_type() == JSON::Class::Object)
+            for (auto const& [name, value] : object_range())
+                if (name == key)
+                    return value;
+        return Tape_View(tape_, strings_, npos);
     }
 
-#if __cplusplus >= 202002L
-    constexpr inline std::string make_empty_string() const noexcept
-#else
-    inline std::string make_empty_string() const noexcept
-#endif
+    inline Tape_View operator[](size_t index) const noexcept
     {
-        return std::string{};
+        if (JSON_type() == JSON::Class::Array)
+            for (auto value : array_range())
+                if (index-- == 0)
+                    return value;
+        return Tape_View(tape_, strings_, npos);
     }
 
-    template<typename Container,
-             typename = std::enable_if<detail::is_Object_Variant<Container>>>
-    class JSON_Wrapper
+    inline Tape_View at(std::string_view key) const noexcept
     {
-        using Container_PTR = std::shared_ptr<Container>;
-        std::optional<Container_PTR> object;
+        return (*this)[key];
+    }
 
-      public:
-        explicit JSON_Wrapper(Container_PTR val)
-            : object(val)
-        {
-        }
+    inline Tape_View at(size_t index) const noexcept { return (*this)[index]; }
 
-        explicit JSON_Wrapper()
-            : object(std::nullopt)
-        {
-        }
+    inline bool has_key(std::string_view key) const noexcept
+    {
+        return JSON_type() == JSON::Class::Object && (*this)[key].valid();
+    }
 
-        constexpr inline typename Container::iterator begin() noexcept
-        {
-            return object ? object.value()->begin()
-                          : typename Container::iterator();
-        }
-        constexpr inline typename Container::iterator end() noexcept
-        {
-            return object ? object.value()->end()
-                          : typename Container::iterator();
-        }
-        constexpr inline typename Container::const_iterator begin()
-            const noexcept
-        {
-            return object ? object.value()->begin()
-                          : typename Container::iterator();
-        }
-        constexpr inline typename Container::const_iterator end() const noexcept
-        {
-            return object ? object.value()->end()
-                          : typename Container::iterator();
-        }
-    };
+    // empty unless this is an object
+    constexpr inline Range<true> object_range() const noexcept
+    {
+        return range<true>(JSON::Class::Object);
+    }
 
-    template<typename Container,
-             typename = std::enable_if<detail::is_Object_Variant<Container>>>
-    class JSON_Const_Wrapper
+    // empty unless this is an array
+    constexpr inline Range<false> array_range() const noexcept
     {
-        using Container_PTR = std::shared_ptr<Container>;
-        std::optional<Container_PTR> object;
+        return range<false>(JSON::Class::Array);
+    }
 
-      public:
-        explicit JSON_Const_Wrapper(Container_PTR const val)
-            : object(val)
-        {
-        }
-        explicit JSON_Const_Wrapper()
-            : object(std::nullopt)
-        {
+    // Materialize a mutable JSON copy
+    JSON to_json() const
+    {
+        if (!valid())
+            return JSON();
+        detail::Builder builder;
+        // open containers, an object expects a key before each value
+        std::vector<bool> objects{};
+        bool key_next = false;
+        size_t last = detail::tape::next(tape_, index_);
+        for (size_t i = index_; i < last;) {
+            Tape_View view(tape_, strings_, i);
+            char tag = detail::tape::tag(tape_[i]);
+            if (key_next && tag == '"') {
+                builder.key(view.to_string());
+                key_next = false;
+                ++i;
+                continue;
+            }
+            switch (tag) {
+                case '{':
+                case '[':
+                    if (tag == '{')
+                        builder.begin_object(view.size());
+                    else
+                        builder.begin_array(view.size());
+                    objects.push_back(tag == '{');
+                    key_next = tag == '{';
+                    ++i;
+                    continue;
+                case '}':
+                case ']':
+                    if (tag == '}')
+                        builder.end_object();
+                    else
+                        builder.end_array();
+                    objects.pop_back();
+                    ++i;
+                    break;
+                default:
+                    emit_scalar(view, builder);
+                    i = detail::tape::next(tape_, i);
+                    break;
+            }
+            key_next = !objects.empty() && objects.back();
         }
+        return builder.take();
+    }
 
-        constexpr inline JSON& operator[](int index) const
-        {
-            return object.value()->at(index);
-        }
-        constexpr inline typename Container::const_iterator begin()
-            const noexcept
-        {
-            return object ? object.value()->begin()
-                          : typename Container::const_iterator();
-        }
-        constexpr inline typename Container::const_iterator end() const noexcept
-        {
-            return object ? object.value()->end()
-                          : typename Container::const_iterator();
-        }
-    };
+  private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
 
-    static inline JSON make(Class type)
+    constexpr inline bool valid() const noexcept { return index_ != npos; }
+    constexpr inline uint64_t word() const noexcept { return tape_[index_]; }
+
+    // the length-prefixed text the entry points at
+    inline std::string_view text() const noexcept
     {
-        JSON ret;
-        ret.set_type(type);
-        return ret;
+        const char* at = strings_ + (word() & detail::tape::payload_mask);
+        uint32_t length = 0;
+        std::memcpy(&length, at, sizeof(length));
+        return std::string_view(at + sizeof(length), length);
     }
 
-    static JSON load(std::string_view) noexcept;
-
-    static JSON load_file(std::string_view);
+    constexpr inline bool is_container() const noexcept
+    {
+        return JSON_type() == JSON::Class::Object ||
+               JSON_type() == JSON::Class::Array;
+    }
 
-    template<typename T>
-    inline void append(T arg)
+    // index of the closing entry
+    constexpr inline size_t close() const noexcept
     {
-        set_type(Class::Array);
-        Internal.List.value()->emplace_back(arg);
+        return static_cast<uint32_t>(word()) - 1;
     }
 
-    template<typename T, typename... U>
-    inline void append(T arg, U... args)
+    template<bool Members>
+    constexpr inline Range<Members> range(JSON::Class type) const noexcept
     {
-        append(arg);
-        append(args...);
+        if (JSON_type() != type)
+            return Range<Members>(tape_, strings_, 0, 0);
+        return Range<Members>(tape_, strings_, index_ + 1, close());
     }
 
-    template<typename T>
-    typename std::enable_if<std::is_same<T, bool>::value, JSON&>::type
-    operator=(T b)
+    static void emit_scalar(Tape_View view, detail::Builder& builder)
     {
-        set_type(Class::Boolean);
-        Internal.data_ = b;
-        return *this;
+        switch (view.JSON_type()) {
+            case JSON::Class::String:
+                builder.string(view.to_string());
+                break;
+            case JSON::Class::Integral:
+                if (detail::tape::tag(view.word()) == 'L')
+                    builder.number(view.text());
+                else
+                    builder.integral(view.to_int());
+                break;
+            case JSON::Class::Floating:
+                builder.floating(view.to_float());
+                break;
+            case JSON::Class::Boolean:
+                builder.boolean(view.to_bool());
+                break;
+            default:
+                builder.null();
+                break;
+        }
     }
 
-    template<typename T>
-    typename std::enable_if<std::is_integral<T>::value &&
-                                !std::is_same<T, bool>::value,
-                            JSON&>::type
-    operator=(T i)
+    uint64_t const* tape_;
+    const char* strings_;
+    size_t index_;
+};
+
+// read-only document parsed into a flat tape and a string buffer
+class Tape_Document
+{
+  public:
+    // a null document
+    Tape_Document()
+        : tape_{ detail::tape::entry('n') }
     {
-        set_type(Class::Integral);
-        std::get<long>(Internal.data_) = i;
-        return *this;
     }
 
-    template<typename T>
-    typename std::enable_if<std::is_floating_point<T>::value, JSON&>::type
-    operator=(T f)
+    // Parse input, a null document on malformed input
+    static Tape_Document load(std::string_view input,
+                              Options const& options = Options{})
     {
-        set_type(Class::Floating);
-        std::get<double>(Internal.data_) = f;
-        return *this;
+        Parse_Error error{};
+        return load(input, error, options);
     }
 
-    template<typename T>
-    typename std::enable_if<std::is_convertible<T, std::string>::value,
-                            JSON&>::type
-    operator=(T s)
+    // As load(input), with the reason for a null document in error
+    static Tape_Document load(std::string_view input,
+                              Parse_Error& error,
+                              Options const& options = Options{})
     {
-        set_type(Class::String);
-        Internal.String = detail::make_data_object<detail::JSON_String>(s);
-        return *this;
+        using Token = detail::Tokenizer::Token;
+        using Code = Parse_Error::Code;
+        error = Parse_Error{};
+        Tape_Document document{};
+        auto& tape = document.tape_;
+        auto& strings = document.strings_;
+        tape.clear();
+
+        detail::Tokenizer tokenizer(input);
+        std::string scratch{};
+        // open entry and element count of each unclosed container
+        std::vector<std::pair<size_t, uint64_t>> open{};
+        // offset is from the start of the token that failed
+        auto fail = [&](Code code, size_t offset = 0) {
+            error.code = code;
+            error.offset = tokenizer.begin_offset() + offset;
+            error.locate(input);
+            return Tape_Document();
+        };
+        // length-prefixed text in the string buffer, decoded for strings
+        auto text = [&](char tag, std::string_view raw) {
+            size_t offset = strings.size();
+            strings.resize(offset + sizeof(uint32_t));
+            if (tag == 'L')
+                strings.insert(strings.end(), raw.begin(), raw.end());
+            else if (!detail::append_unquoted(raw, scratch, strings, error))
+                return false;
+            auto length = static_cast<uint32_t>(strings.size() - offset -
+                                                sizeof(uint32_t));
+            std::memcpy(strings.data() + offset, &length, sizeof(length));
+            tape.push_back(detail::tape::entry(tag, offset));
+            return true;
+        };
+
+        for (Token token = tokenizer.next(); token != Token::End;
+             token = tokenizer.next()) {
+            if (token == Token::Key) {
+                if (!text('"', tokenizer.raw()))
+                    return fail(error.code, error.offset);
+                continue;
+            }
+            if (token == Token::End_Object || token == Token::End_Array) {
+                auto [begin, count] = open.back();
+                open.pop_back();
+                tape.push_back(detail::tape::entry(
+                    token == Token::End_Object ? '}' : ']', begin));
+                tape[begin] |= std::min(count, detail::tape::count_limit)
+                                   << 32 |
+                               tape.size();
+                continue;
+            }
+            if (!open.empty())
+                ++open.back().second;
+            switch (token) {
+                case Token::Begin_Object:
+                case Token::Begin_Array:
+                    if (open.size() >= options.max_depth)
+                        return fail(Code::max_depth);
+                    open.emplace_back(tape.size(), 0);
+                    tape.push_back(detail::tape::entry(
+                        token == Token::Begin_Object ? '{' : '['));
+                    break;
+                case Token::String:
+                    if (!text('"', tokenizer.raw()))
+                        return fail(error.code, error.offset);
+                    break;
+                case Token::Number: {
+                    using Kind = detail::Token_Number;
+                    long integral = 0;
+                    double floating = 0;
+                    switch (detail::token_number(
+                        tokenizer.raw(), scratch, integral, floating)) {
+                        case Kind::integral:
+                            tape.push_back(detail::tape::entry('l'));
+                            tape.push_back(static_cast<uint64_t>(integral));
+                            break;
+                        case Kind::floating: {
+                            uint64_t bits = 0;
+                            std::memcpy(&bits, &floating, sizeof(bits));
+                            tape.push_back(detail::tape::entry('d'));
+                            tape.push_back(bits);
+                        } break;
+                        case Kind::text:
+                            text('L', tokenizer.raw());
+                            break;
+                    }
+                } break;
+                case Token::Boolean:
+                    tape.push_back(
+                        detail::tape::entry(tokenizer.raw()[0] == 't' ? 't'
+                                                                      : 'f'));
+                    break;
+                case Token::Null:
+                    tape.push_back(detail::tape::entry('n'));
+                    break;
+                default:
+                    return fail(tokenizer.error_code());
+            }
+        }
+        if (tape.empty())
+            return fail(Code::unexpected_end);
+        // End stops after the whitespace that follows the value
+        if (tokenizer.offset() != input.size())
+            return fail(Code::trailing_content);
+        tape.shrink_to_fit();
+        strings.shrink_to_fit();
+        return document;
     }
 
-    inline JSON& operator[](std::string const& key) noexcept
+    inline Tape_View root() const noexcept
     {
-        set_type(Class::Object);
-        return Internal.Map.value()->operator[](key);
+        return Tape_View(tape_.data(), strings_.data(), 0);
+    }
+    inline Tape_View operator[](std::string_view key) const noexcept
+    {
+        return root()[key];
+    }
+    inline Tape_View operator[](size_t index) const noexcept
+    {
+        return root()[index];
     }
+    inline Tape_View at(std::string_view key) const noexcept
+    {
+        return root()[key];
+    }
+    inline Tape_View at(size_t index) const noexcept { return root()[index]; }
+    inline JSON::Class JSON_type() const noexcept
+    {
+        return root().JSON_type();
+    }
+    inline bool is_null() const noexcept { return root().is_null(); }
+    inline size_t size() const noexcept { return root().size(); }
+    inline JSON to_json() const { return root().to_json(); }
 
-    inline const JSON& operator[](std::string const& key) const noexcept
+    // bytes held by the tape and the string buffer
+    inline size_t memory_usage() const noexcept
     {
-        set_type(Class::Object);
-        return Internal.Map.value()->operator[](key);
+        return tape_.capacity() * sizeof(uint64_t) + strings_.capacity();
     }
 
-    inline JSON& operator[](unsigned index) noexcept
+  private:
+    std::vector<uint64_t> tape_{};
+    std::vector<char> strings_{};
+};
+
+///////////////////////
+// Atomic documents
+//////////////////////
+
+// live document replaced under readers without locking
+class Atomic_Document
+{
+    // hazard record, on a list that only grows until the holder goes
+    struct alignas(64) Slot
     {
-        set_type(Class::Array);
-        if (index >= Internal.List.value()->size())
-            Internal.List.value()->resize(index + 1);
+        std::atomic<bool> owned{ false };
+        std::atomic<Frozen_Document const*> hazard{ nullptr };
+        Slot* next = nullptr;
+    };
 
-        return Internal.List.value()->operator[](index);
-    }
+  public:
+    class Snapshot
+    {
+      public:
+        Snapshot(Snapshot&& other) noexcept
+            : document_(std::exchange(other.document_, nullptr))
+            , slot_(std::exchange(other.slot_, nullptr))
+        {
+        }
 
-    inline JSON& at(const std::string& key)
+        Snapshot& operator=(Snapshot&& other) noexcept
+        {
+            if (this != &other) {
+                release();
+                document_ = std::exchange(other.document_, nullptr);
+                slot_ = std::exchange(other.slot_, nullptr);
+            }
+            return *this;
+        }
+
+        Snapshot(Snapshot const&) = delete;
+        Snapshot& operator=(Snapshot const&) = delete;
+
+        ~Snapshot() { release(); }
+
+        inline Frozen_Document const& operator*() const noexcept
+        {
+            return *document_;
+        }
+        inline Frozen_Document const* operator->() const noexcept
+        {
+            return document_;
+        }
+        inline Static_View operator[](std::string_view key) const noexcept
+        {
+            return (*document_)[key];
+        }
+
+      private:
+        friend class Atomic_Document;
+
+        Snapshot(Frozen_Document const* document, Slot* slot) noexcept
+            : document_(document)
+            , slot_(slot)
+        {
+        }
+
+        inline void release() noexcept
+        {
+            if (!slot_)
+                return;
+            slot_->hazard.store(nullptr, std::memory_order_release);
+            slot_->owned.store(false, std::memory_order_release);
+            slot_ = nullptr;
+        }
+
+        Frozen_Document const* document_;
+        Slot* slot_;
+    };
+
+    // `readers` hazard records are made up front, more when all are held
+    explicit Atomic_Document(size_t readers = 128)
+        : Atomic_Document(Frozen_Document{}, readers)
     {
-        return Internal.Map.value()->operator[](key);
     }
 
-    inline const JSON& at(const std::string& key) const
+    explicit Atomic_Document(Frozen_Document document, size_t readers = 128)
+        : current_(new Frozen_Document(std::move(document)))
     {
-        set_type(Class::Object);
-        return Internal.Map.value()->operator[](key);
+        for (size_t i = 0; i < readers; ++i)
+            add_slot()->owned.store(false, std::memory_order_relaxed);
     }
 
-    inline JSON& at(unsigned index) { return operator[](index); }
+    Atomic_Document(Atomic_Document const&) = delete;
+    Atomic_Document& operator=(Atomic_Document const&) = delete;
 
-    inline const JSON& at(unsigned index) const
+    // No snapshot may outlive the holder
+    ~Atomic_Document()
     {
-        return Internal.List.value()->operator[](index);
+        delete current_.load();
+        for (auto* document : retired_)
+            delete document;
+        for (Slot* slot = slots_.load(); slot;)
+            delete std::exchange(slot, slot->next);
     }
 
-    constexpr inline size_t length() const
+    Snapshot snapshot() const noexcept
     {
-        if (Type == Class::Array)
-            return Internal.List.value()->size();
-        else
-            return -1UL;
+        Slot* slot = nullptr;
+        for (Slot* candidate = slots_.load(std::memory_order_acquire);
+             candidate;
+             candidate = candidate->next) {
+            if (!candidate->owned.load(std::memory_order_relaxed) &&
+                !candidate->owned.exchange(true, std::memory_order_acquire)) {
+                slot = candidate;
+                break;
+            }
+        }
+        if (!slot)
+            slot = add_slot();
+        // publish the hazard, then confirm the document is still current
+        Frozen_Document const* document = current_.load();
+        while (true) {
+            slot->hazard.store(document);
+            Frozen_Document const* again = current_.load();
+            if (again == document)
+                break;
+            document = again;
+        }
+        return Snapshot(document, slot);
     }
 
-    constexpr inline bool has_key(const std::string& key) const
+    void publish(Frozen_Document document)
     {
-        if (Type == Class::Object) {
-#if __cplusplus >= 202002L
-            return Internal.Map.value()->contains(key);
-#else
-            return Internal.Map.value()->find(key) !=
-                   Internal.Map.value()->end();
-#endif
-        }
-
-        return false;
+        auto* next = new Frozen_Document(std::move(document));
+        std::lock_guard<std::mutex> lock(writer_);
+        retired_.push_back(current_.exchange(next));
+        reclaim();
     }
 
-    std::vector<std::string> dump_keys() const
+    inline void publish(JSON const& document) { publish(document.freeze()); }
+
+  private:
+    // a record owned by the caller, pushed without a lock
+    Slot* add_slot() const
     {
-        auto data = *Internal.Map.value();
-        std::vector<std::string> keys{};
-        std::transform(data.begin(),
-                       data.end(),
-                       std::back_inserter(keys),
-                       [](const auto& pair) { return pair.first; });
-        return keys;
+        auto* slot = new Slot{};
+        slot->owned.store(true, std::memory_order_relaxed);
+        Slot* head = slots_.load(std::memory_order_relaxed);
+        // sequentially consistent, so reclaim() sees the record before
+        // the hazard placed on it
+        do
+            slot->next = head;
+        while (!slots_.compare_exchange_weak(head, slot));
+        return slot;
     }
 
-    constexpr inline size_t size() const noexcept
+    // free retired documents that no reader has a hazard on, writer only
+    void reclaim()
     {
-        if (Type == Class::Object)
-            return Internal.Map.value()->size();
-        else if (Type == Class::Array)
-            return Internal.List.value()->size();
-        else
-            return -1UL;
+        std::vector<Frozen_Document const*> hazards{};
+        for (Slot* slot = slots_.load(); slot; slot = slot->next)
+            if (auto* document = slot->hazard.load())
+                hazards.push_back(document);
+        auto live = std::remove_if(
+            retired_.begin(), retired_.end(), [&](auto* document) {
+                if (std::find(hazards.begin(), hazards.end(), document) !=
+                    hazards.end())
+                    return false;
+                delete document;
+                return true;
+            });
+        retired_.erase(live, retired_.end());
     }
 
-    constexpr inline Class JSON_type() const noexcept { return Type; }
-
-    constexpr inline bool is_null() const { return Type == Class::Null; }
+    mutable std::atomic<Slot*> slots_{ nullptr };
+    std::atomic<Frozen_Document const*> current_;
+    std::mutex writer_{};
+    std::vector<Frozen_Document const*> retired_{};
+};
 
 #if __cplusplus >= 202002L
-    constexpr inline detail::JSON_String to_string() const noexcept
-#else
-    inline detail::JSON_String to_string() const noexcept
-#endif
-    {
-        return Type == Class::String
-                   ? detail::json_escape(*(Internal.String.value()))
-                   : std::string("");
-    }
 
-    inline detail::JSON_Deque to_deque() const noexcept
+///////////////////////
+// Compile-time documents
+//////////////////////
+
+namespace detail {
+
+template<size_t N>
+struct Fixed_String
+{
+    constexpr Fixed_String(const char (&str)[N])
     {
-        return Type == Class::Array ? *Internal.List.value()
-                                    : make_empty_list();
+        std::copy_n(str, N, data);
     }
+    constexpr std::string_view view() const { return { data, N - 1 }; }
+    char data[N]{};
+};
 
-    inline detail::JSON_Map to_map() const noexcept
-    {
-        return Type == Class::Object ? *Internal.Map.value() : make_empty_map();
-    }
+// Unsigned integer wide enough to convert a number literal exactly
+struct Big_Integer
+{
+    std::array<uint32_t, 160> words{};
+    size_t size = 0;
 
-    constexpr inline double to_float() const noexcept
+    constexpr void push(uint32_t word)
     {
-        return Type == Class::Floating ? std::get<double>(Internal.data_) : 0.0;
+        if (size == words.size())
+            throw "simplejson: number literal too long";
+        words[size++] = word;
     }
 
-    constexpr inline long to_int() const noexcept
+    constexpr void multiply(uint32_t factor)
     {
-        return Type == Class::Integral ? std::get<long>(Internal.data_) : 0;
+        uint64_t carry = 0;
+        for (size_t i = 0; i < size; ++i) {
+            uint64_t product = uint64_t{ words[i] } * factor + carry;
+            words[i] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry)
+            push(static_cast<uint32_t>(carry));
     }
 
-    constexpr inline bool to_bool() const noexcept
+    constexpr void add(uint32_t value)
     {
-        return Type == Class::Boolean ? std::get<bool>(Internal.data_) : false;
+        uint64_t carry = value;
+        for (size_t i = 0; i < size && carry; ++i) {
+            uint64_t sum = uint64_t{ words[i] } + carry;
+            words[i] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
+        if (carry)
+            push(static_cast<uint32_t>(carry));
     }
 
-    inline JSON_Wrapper<detail::JSON_Map> object_range() const noexcept
+    constexpr void add(Big_Integer const& other)
     {
-        return JSON_Wrapper<detail::JSON_Map>(Internal.Map.value());
+        uint64_t carry = 0;
+        for (size_t i = 0; i < other.size || carry; ++i) {
+            if (i == size)
+                push(0);
+            uint64_t sum = uint64_t{ words[i] } + carry;
+            if (i < other.size)
+                sum += other.words[i];
+            words[i] = static_cast<uint32_t>(sum);
+            carry = sum >> 32;
+        }
     }
 
-    inline JSON_Wrapper<detail::JSON_Deque> array_range() const noexcept
+    constexpr void multiply_pow5(int n)
     {
-        return JSON_Wrapper<detail::JSON_Deque>(Internal.List.value());
+        for (; n >= 13; n -= 13)
+            multiply(1220703125);
+        uint32_t factor = 1;
+        for (; n > 0; --n)
+            factor *= 5;
+        multiply(factor);
     }
 
-    std::string dump(int depth = 1, std::string tab = "  ") const noexcept
+    constexpr void shift_left(int bits)
     {
-        std::string pad = "";
-        for (int i = 0; i < depth; ++i, pad += tab)
-            ;
-        switch (Type) {
-            case Class::Null:
-                return "null";
-            case Class::Object: {
-                std::string s = "{\n";
-                bool skip = true;
-                for (auto& p : *(Internal.Map.value())) {
-                    if (!skip)
-                        s += ",\n";
-                    s += (pad + "\"" + p.first +
-                          "\" : " + p.second.dump(depth + 1, tab));
-                    skip = false;
-                }
-                s += ("\n" + pad.erase(0, 2) + "}");
-                return s;
-            }
-            case Class::Array: {
-                std::string s = "[";
-                bool skip = true;
-                for (auto& p : *(Internal.List.value())) {
-                    if (!skip)
-                        s += ", ";
-                    s += p.dump(depth + 1, tab);
-                    skip = false;
-                }
-                s += "]";
-                return s;
-            }
-            case Class::String:
-                return "\"" + detail::json_escape(*(Internal.String.value())) +
-                       "\"";
-            case Class::Floating:
-                return std::to_string(std::get<double>(Internal.data_));
-            case Class::Integral:
-                return std::to_string(std::get<long>(Internal.data_));
-            case Class::Boolean:
-                return std::get<bool>(Internal.data_) ? "true" : "false";
+        if (size == 0)
+            return;
+        size_t whole = static_cast<size_t>(bits) / 32;
+        int rest = bits % 32;
+        push(0);
+        for (size_t i = 0; i < whole; ++i)
+            push(0);
+        for (size_t i = size; i-- > 0;) {
+            uint64_t word = i >= whole ? words[i - whole] : 0;
+            uint64_t low = i > whole ? words[i - whole - 1] : 0;
+            words[i] = static_cast<uint32_t>(
+                (word << rest) | (rest ? low >> (32 - rest) : 0));
         }
-        return "";
+        while (size > 0 && words[size - 1] == 0)
+            --size;
     }
 
-    friend std::ostream& operator<<(std::ostream&, const JSON&);
-
-  private:
-    inline void set_type(Class type) const noexcept
+    constexpr Big_Integer times(uint64_t factor) const
     {
-        if (type == Type)
-            return;
-
-        // reset internal state
-        this->Internal = internal();
-
-        switch (type) {
-            case Class::Null:
-                break;
-            case Class::Object:
-                Internal.Map = detail::make_data_object<detail::JSON_Map>(
-                    make_empty_map());
-                break;
-            case Class::Array:
-                Internal.List = detail::make_data_object<detail::JSON_Deque>(
-                    make_empty_list());
-                break;
-            case Class::String:
-                Internal.String = detail::make_data_object<detail::JSON_String>(
-                    make_empty_string());
-                break;
-            case Class::Floating:
-                Internal.data_ = static_cast<double>(0.0);
-                break;
-            case Class::Integral:
-                Internal.data_ = static_cast<int>(0);
-                break;
-            case Class::Boolean:
-                Internal.data_ = static_cast<bool>(false);
-                break;
-        }
-
-        Type = type;
+        Big_Integer low = *this;
+        low.multiply(static_cast<uint32_t>(factor));
+        Big_Integer high = *this;
+        high.multiply(static_cast<uint32_t>(factor >> 32));
+        high.shift_left(32);
+        low.add(high);
+        return low;
     }
 
-  private:
-    mutable Class Type = Class::Null;
+    friend constexpr int compare(Big_Integer const& a, Big_Integer const& b)
+    {
+        if (a.size != b.size)
+            return a.size < b.size ? -1 : 1;
+        for (size_t i = a.size; i-- > 0;)
+            if (a.words[i] != b.words[i])
+                return a.words[i] < b.words[i] ? -1 : 1;
+        return 0;
+    }
 };
 
-inline JSON array() noexcept
+// digits * 10^exponent correctly rounded, starting from guess
+constexpr double exact_double(Big_Integer const& digits,
+                              int exponent,
+                              double guess)
 {
-    return JSON::make(JSON::Class::Array);
-}
+    constexpr uint64_t hidden = uint64_t{ 1 } << 52;
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+    if (digits.size == 0)
+        return 0.0;
+    // the value is scaled * 2^exponent / fives
+    Big_Integer scaled = digits;
+    Big_Integer fives{};
+    fives.push(1);
+    if (exponent >= 0)
+        scaled.multiply_pow5(exponent);
+    else
+        fives.multiply_pow5(-exponent);
+    // sign of the value less k * 2^e
+    auto compare_to = [&](uint64_t k, int e) {
+        Big_Integer left = scaled;
+        Big_Integer right = fives.times(k);
+        if (exponent > e)
+            left.shift_left(exponent - e);
+        else
+            right.shift_left(e - exponent);
+        return compare(left, right);
+    };
 
-template<typename... T>
-inline JSON array(T... args) noexcept
-{
-    JSON arr = JSON::make(JSON::Class::Array);
-    arr.append(args...);
-    return arr;
+    // the candidate is m * 2^q
+    uint64_t m = 2 * hidden - 1;
+    int q = 971;
+    if (guess != infinity) {
+        auto bits = std::bit_cast<uint64_t>(guess);
+        auto biased = static_cast<int>(bits >> 52);
+        m = bits & (hidden - 1);
+        q = biased ? biased - 1075 : -1074;
+        if (biased)
+            m |= hidden;
+    }
+    while (true) {
+        int above = compare_to(2 * m + 1, q - 1);
+        if (above > 0 || (above == 0 && (m & 1))) {
+            if (++m == 2 * hidden) {
+                m = hidden;
+                ++q;
+            }
+            if (q > 971)
+                return infinity;
+            continue;
+        }
+        if (m == 0)
+            break;
+        // below a power of two the spacing halves
+        bool narrow = m == hidden && q > -1074;
+        int below = narrow ? compare_to(4 * m - 1, q - 2)
+                           : compare_to(2 * m - 1, q - 1);
+        if (below < 0 || (below == 0 && (m & 1))) {
+            if (narrow) {
+                m = 2 * hidden - 1;
+                --q;
+            } else {
+                --m;
+            }
+            continue;
+        }
+        break;
+    }
+    uint64_t bits = m < hidden
+                        ? m
+                        : (uint64_t(q + 1075) << 52) | (m & (hidden - 1));
+    return std::bit_cast<double>(bits);
 }
 
-inline JSON object() noexcept
+struct Static_Measure
 {
-    return JSON::make(JSON::Class::Object);
-}
+    size_t nodes = 0;
+    size_t depth = 0;
+};
 
-namespace detail {
-template<typename Type>
-Type get_safe_data_object(std::optional<std::shared_ptr<Type>> const& type)
+// upper bound on the node count and nesting depth of a literal
+constexpr Static_Measure measure_static(std::string_view in)
 {
-    if constexpr (std::is_same_v<Type, detail::JSON_Map>) {
-        return type.has_value() ? *type.value() : std::map<std::string, JSON>{};
-    } else if constexpr (std::is_same_v<Type, detail::JSON_Deque>) {
-        return type.has_value() ? *type.value() : std::deque<JSON>{};
-    } else {
-        return type.has_value() ? *type.value() : std::string{};
+    Static_Measure result{};
+    size_t depth = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        char c = in[i];
+        if (c == '{' || c == '[') {
+            ++result.nodes;
+            result.depth = std::max(result.depth, ++depth);
+        } else if ((c == '}' || c == ']') && depth > 0) {
+            --depth;
+        } else if (c == '\"') {
+            ++result.nodes;
+            for (++i; i < in.size() && in[i] != '\"'; ++i)
+                if (in[i] == '\\')
+                    ++i;
+        } else if (c == '-' || (c >= '0' && c <= '9') || c == 't' ||
+                   c == 'f' || c == 'n') {
+            ++result.nodes;
+            while (i + 1 < in.size() && !is_delimiter(in[i + 1]))
+                ++i;
+        }
     }
+    return result;
 }
+
 } // namespace detail
 
-namespace {
+// node and string tables of a document parsed at compile time
+template<size_t N, size_t B, size_t D>
+struct Static_Document
+{
+    constexpr Static_View root() const noexcept
+    {
+        return Static_View(nodes.data(), strings.data(), 0);
+    }
+    constexpr Static_View operator[](std::string_view key) const noexcept
+    {
+        return root()[key];
+    }
+    constexpr Static_View operator[](size_t index) const noexcept
+    {
+        return root()[index];
+    }
+    constexpr JSON::Class JSON_type() const noexcept
+    {
+        return root().JSON_type();
+    }
+    constexpr size_t size() const noexcept { return root().size(); }
+    JSON to_json() const { return root().to_json(); }
 
-JSON parse_next(std::string const&, size_t&) noexcept;
+    std::array<detail::Static_Node, N> nodes{};
+    std::array<char, B> strings{};
+    size_t count = 0;
+};
 
-inline void consume_ws(std::string const& str, size_t& offset) noexcept
-{
-    while (isspace(str[offset]))
-        ++offset;
-}
+namespace detail {
 
-JSON parse_object(std::string const& str, size_t& offset) noexcept
+// strict constexpr parser, malformed input fails to compile
+template<size_t N, size_t B, size_t D>
+class Static_Parser
 {
-    JSON obj = JSON::make(JSON::Class::Object);
-
-    ++offset;
-    consume_ws(str, offset);
-    if (str[offset] == '}') {
-        ++offset;
-        return obj;
+  public:
+    constexpr explicit Static_Parser(std::string_view in)
+        : in_(in)
+    {
     }
 
-    while (true) {
-        JSON Key = parse_next(str, offset);
-        consume_ws(str, offset);
-        if (str[offset] != ':') {
-            std::cerr << "Error: Object: Expected colon, found '" << str[offset]
-                      << "'\n";
-            break;
+    constexpr Static_Document<N, B, D> parse()
+    {
+        while (true) {
+            ws();
+            if (parse_value())
+                continue;
+            // close every container that ends here
+            while (true) {
+                ws();
+                if (top_ == 0) {
+                    if (pos_ != in_.size())
+                        throw "simplejson: trailing characters in literal";
+                    return doc_;
+                }
+                auto& parent = doc_.nodes[stack_[top_ - 1]];
+                bool is_object = parent.type == JSON::Class::Object;
+                char c = peek();
+                if (c == ',') {
+                    ++pos_;
+                    if (is_object)
+                        parse_key();
+                    break;
+                }
+                if (c != (is_object ? '}' : ']'))
+                    throw "simplejson: expected ',' or a closing bracket";
+                ++pos_;
+                parent.end = static_cast<uint32_t>(doc_.count);
+                --top_;
+            }
         }
-        consume_ws(str, ++offset);
-        JSON Value = parse_next(str, offset);
-        obj[Key.to_string()] = Value;
+    }
 
-        consume_ws(str, offset);
-        if (str[offset] == ',') {
-            ++offset;
-            continue;
-        } else if (str[offset] == '}') {
-            ++offset;
-            break;
-        } else {
-            std::cerr << "ERROR: object: Expected comma, found '" << str[offset]
-                      << "'\n";
-            break;
-        }
+  private:
+    constexpr char peek() const
+    {
+        if (pos_ >= in_.size())
+            throw "simplejson: unexpected end of literal";
+        return in_[pos_];
     }
 
-    return obj;
-}
+    constexpr void ws()
+    {
+        while (pos_ < in_.size() && is_ws(in_[pos_]))
+            ++pos_;
+    }
 
-JSON parse_array(std::string const& str, size_t& offset) noexcept
-{
-    JSON arr = JSON::make(JSON::Class::Array);
-    unsigned index = 0;
+    constexpr Static_Node& add(JSON::Class type)
+    {
+        if (doc_.count >= N)
+            throw "simplejson: node table overflow";
+        auto& node = doc_.nodes[doc_.count];
+        node.type = type;
+        node.end = static_cast<uint32_t>(++doc_.count);
+        if (top_ > 0) {
+            auto& parent = doc_.nodes[stack_[top_ - 1]];
+            ++parent.length;
+            if (parent.type == JSON::Class::Object) {
+                node.key = key_;
+                node.key_length = key_length_;
+            }
+        }
+        return node;
+    }
 
-    ++offset;
-    consume_ws(str, offset);
-    if (str[offset] == ']') {
-        ++offset;
-        return arr;
+    // returns true when a container was opened and its first value follows
+    constexpr bool parse_value()
+    {
+        char c = peek();
+        switch (c) {
+            case '{':
+            case '[': {
+                bool is_object = c == '{';
+                size_t index = doc_.count;
+                add(is_object ? JSON::Class::Object : JSON::Class::Array);
+                ++pos_;
+                ws();
+                if (peek() == (is_object ? '}' : ']')) {
+                    ++pos_;
+                    return false;
+                }
+                if (top_ >= D)
+                    throw "simplejson: nesting too deep";
+                stack_[top_++] = index;
+                if (is_object)
+                    parse_key();
+                return true;
+            }
+            case '\"': {
+                auto [offset, length] = parse_string();
+                auto& node = add(JSON::Class::String);
+                node.offset = offset;
+                node.length = length;
+                return false;
+            }
+            case 't':
+                literal("true");
+                add(JSON::Class::Boolean).integral = 1;
+                return false;
+            case 'f':
+                literal("false");
+                add(JSON::Class::Boolean);
+                return false;
+            case 'n':
+                literal("null");
+                add(JSON::Class::Null);
+                return false;
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) {
+                    parse_number();
+                    return false;
+                }
+        }
+        throw "simplejson: unknown starting character";
     }
 
-    while (true) {
-        arr[index++] = parse_next(str, offset);
-        consume_ws(str, offset);
+    constexpr void parse_key()
+    {
+        ws();
+        if (peek() != '\"')
+            throw "simplejson: expected string key";
+        auto [offset, length] = parse_string();
+        key_ = offset;
+        key_length_ = length;
+        ws();
+        if (peek() != ':')
+            throw "simplejson: expected colon";
+        ++pos_;
+    }
 
-        if (str[offset] == ',') {
-            ++offset;
-            continue;
-        } else if (str[offset] == ']') {
-            ++offset;
-            break;
+    constexpr void literal(std::string_view word)
+    {
+        if (in_.substr(pos_, word.size()) != word)
+            throw "simplejson: unknown literal";
+        pos_ += word.size();
+    }
+
+    constexpr void emit(uint32_t code)
+    {
+        if (code < 0x80) {
+            put(static_cast<char>(code));
+        } else if (code < 0x800) {
+            put(static_cast<char>(0xC0 | (code >> 6)));
+            put(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            put(static_cast<char>(0xE0 | (code >> 12)));
+            put(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            put(static_cast<char>(0x80 | (code & 0x3F)));
         } else {
-            std::cerr << "ERROR: Array: Expected ',' or ']', found '"
-                      << str[offset] << "'\n";
-            return JSON::make(JSON::Class::Array);
+            put(static_cast<char>(0xF0 | (code >> 18)));
+            put(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            put(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            put(static_cast<char>(0x80 | (code & 0x3F)));
         }
     }
 
-    return arr;
-}
+    constexpr void put(char c)
+    {
+        if (bytes_ >= B)
+            throw "simplejson: string table overflow";
+        doc_.strings[bytes_++] = c;
+    }
 
-JSON parse_string(std::string const& str, size_t& offset) noexcept
-{
-    JSON String;
-    std::string val;
-    for (char c = str[++offset]; c != '\"'; c = str[++offset]) {
-        if (c == '\\') {
-            switch (str[++offset]) {
+    constexpr uint32_t hex4()
+    {
+        uint32_t code = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = peek();
+            ++pos_;
+            code <<= 4;
+            if (c >= '0' && c <= '9')
+                code |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                code |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F')
+                code |= static_cast<uint32_t>(c - 'A' + 10);
+            else
+                throw "simplejson: expected hex digit in unicode escape";
+        }
+        return code;
+    }
+
+    constexpr std::pair<uint32_t, uint32_t> parse_string()
+    {
+        auto offset = static_cast<uint32_t>(bytes_);
+        ++pos_;
+        for (char c = peek(); c != '\"'; c = peek()) {
+            ++pos_;
+            if (static_cast<unsigned char>(c) < 0x20)
+                throw "simplejson: control character in string";
+            if (c != '\\') {
+                put(c);
+                continue;
+            }
+            c = peek();
+            ++pos_;
+            switch (c) {
                 case '\"':
-                    val += '\"';
-                    break;
                 case '\\':
-                    val += '\\';
-                    break;
                 case '/':
-                    val += '/';
+                    put(c);
                     break;
                 case 'b':
-                    val += '\b';
+                    put('\b');
                     break;
                 case 'f':
-                    val += '\f';
+                    put('\f');
                     break;
                 case 'n':
-                    val += '\n';
+                    put('\n');
                     break;
                 case 'r':
-                    val += '\r';
+                    put('\r');
                     break;
                 case 't':
-                    val += '\t';
+                    put('\t');
                     break;
                 case 'u': {
-                    val += "\\u";
-                    for (unsigned i = 1; i <= 4; ++i) {
-                        c = str[offset + i];
-                        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
-                            (c >= 'A' && c <= 'F'))
-                            val += c;
-                        else {
-                            std::cerr << "ERROR: String: Expected hex "
-                                         "character in unicode escape, found '"
-                                      << c << "'\n";
-                            return JSON::make(JSON::Class::String);
-                        }
+                    uint32_t code = hex4();
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        if (in_.substr(pos_, 2) != "\\u")
+                            throw "simplejson: unpaired surrogate";
+                        pos_ += 2;
+                        uint32_t low = hex4();
+                        if (low < 0xDC00 || low > 0xDFFF)
+                            throw "simplejson: invalid low surrogate";
+                        code = 0x10000 + ((code - 0xD800) << 10) +
+                               (low - 0xDC00);
+                    } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                        throw "simplejson: unpaired surrogate";
                     }
-                    offset += 4;
+                    emit(code);
                 } break;
                 default:
-                    val += '\\';
-                    break;
+                    throw "simplejson: invalid escape";
             }
-        } else
-            val += c;
+        }
+        ++pos_;
+        return { offset, static_cast<uint32_t>(bytes_) - offset };
     }
-    ++offset;
-    String = val;
-    return String;
-}
 
-JSON parse_number(std::string const& str, size_t& offset) noexcept
-{
-    JSON Number;
-    std::string val, exp_str;
-    char c;
-    bool isDouble = false;
-    long exp = 0;
-    while (true) {
-        c = str[offset++];
-        if ((c == '-') || (c >= '0' && c <= '9'))
-            val += c;
-        else if (c == '.') {
-            val += c;
-            isDouble = true;
-        } else
-            break;
-    }
-    if (c == 'E' || c == 'e') {
-        c = str[offset++];
-        if (c == '-') {
-            ++offset;
-            exp_str += '-';
+    constexpr size_t digits(uint64_t& mantissa, int& dropped)
+    {
+        size_t count = 0;
+        while (pos_ < in_.size() && in_[pos_] >= '0' && in_[pos_] <= '9') {
+            if (mantissa < 1000000000000000000ULL)
+                mantissa = mantissa * 10 +
+                           static_cast<uint64_t>(in_[pos_] - '0');
+            else
+                ++dropped;
+            ++pos_;
+            ++count;
         }
-        while (true) {
-            c = str[offset++];
-            if (c >= '0' && c <= '9')
-                exp_str += c;
-            else if (!isspace(c) && c != ',' && c != ']' && c != '}') {
-                std::cerr
-                    << "ERROR: Number: Expected a number for exponent, found '"
-                    << c << "'\n";
-                return JSON::make(JSON::Class::Null);
-            } else
-                break;
-        }
-        exp = std::stol(exp_str);
-    } else if (!isspace(c) && c != ',' && c != ']' && c != '}') {
-        std::cerr << "ERROR: Number: unexpected character '" << c << "'\n";
-        return JSON::make(JSON::Class::Null);
-    }
-    --offset;
-
-    if (isDouble)
-        Number = std::stod(val) * std::pow(10, exp);
-    else {
-        if (!exp_str.empty())
-            Number = std::stol(val) * std::pow(10, exp);
-        else
-            Number = std::stol(val);
-    }
-    return Number;
-}
-JSON parse_bool(std::string const& str, size_t& offset) noexcept
-{
-    JSON Bool;
-    if (str.substr(offset, 4) == "true")
-        Bool = true;
-    else if (str.substr(offset, 5) == "false")
-        Bool = false;
-    else {
-        std::cerr << "ERROR: Bool: Expected 'true' or 'false', found '"
-                  << str.substr(offset, 5) << "'\n";
-        return JSON::make(JSON::Class::Null);
-    }
-    offset += (Bool.to_bool() ? 4 : 5);
-    return Bool;
-}
-JSON parse_null(std::string const& str, size_t& offset)
-{
-    JSON Null;
-    if (str.substr(offset, 4) != "null") {
-        std::cerr << "ERROR: Null: Expected 'null', found '"
-                  << str.substr(offset, 4) << "'\n";
-        return JSON::make(JSON::Class::Null);
+        return count;
     }
-    offset += 4;
-    return Null;
-}
-JSON parse_next(std::string const& str, size_t& offset) noexcept
-{
-    char value;
-    consume_ws(str, offset);
-    value = str[offset];
-    switch (value) {
-        case '[':
-            return parse_array(str, offset);
-        case '{':
-            return parse_object(str, offset);
-        case '\"':
-            return parse_string(str, offset);
-        case 't':
-        case 'f':
-            return parse_bool(str, offset);
-        case 'n':
-            return parse_null(str, offset);
-        default:
-            if ((value <= '9' && value >= '0') || value == '-')
-                return parse_number(str, offset);
+
+    constexpr void parse_number()
+    {
+        bool negative = in_[pos_] == '-';
+        if (negative)
+            ++pos_;
+        uint64_t mantissa = 0;
+        int dropped = 0;
+        size_t integer = pos_;
+        if (digits(mantissa, dropped) == 0)
+            throw "simplejson: expected digit";
+        if (in_[integer] == '0' && pos_ - integer > 1)
+            throw "simplejson: leading zero in number";
+        size_t integer_end = pos_;
+        size_t fraction = pos_;
+        int exponent = dropped;
+        bool is_floating = false;
+        if (pos_ < in_.size() && in_[pos_] == '.') {
+            ++pos_;
+            is_floating = true;
+            int ignored = 0;
+            fraction = pos_;
+            if (digits(mantissa, ignored) == 0)
+                throw "simplejson: expected digit after decimal point";
+            exponent -= static_cast<int>(pos_ - fraction) - ignored;
+        }
+        size_t fraction_end = is_floating ? pos_ : fraction;
+        int scale = 0;
+        if (pos_ < in_.size() && (in_[pos_] == 'e' || in_[pos_] == 'E')) {
+            ++pos_;
+            is_floating = true;
+            bool negative_exponent = false;
+            if (pos_ < in_.size() && (in_[pos_] == '+' || in_[pos_] == '-'))
+                negative_exponent = in_[pos_++] == '-';
+            uint64_t value = 0;
+            int ignored = 0;
+            if (digits(value, ignored) == 0)
+                throw "simplejson: expected digit in exponent";
+            // anything larger is zero or infinity whatever the digits
+            scale = value > 100000 ? 100000 : static_cast<int>(value);
+            if (negative_exponent)
+                scale = -scale;
+        }
+        exponent += scale;
+        if (pos_ < in_.size() && !is_delimiter(in_[pos_]))
+            throw "simplejson: unexpected character after number";
+
+        if (!is_floating) {
+            // JSON::load keeps the text of larger integers, a node cannot
+            uint64_t limit = static_cast<uint64_t>(LONG_MAX) + negative;
+            if (dropped != 0 || mantissa > limit)
+                throw "simplejson: integer literal does not fit a long";
+            add(JSON::Class::Integral).integral =
+                negative ? -static_cast<long>(mantissa - 1) - 1
+                         : static_cast<long>(mantissa);
+            return;
+        }
+        // every significant digit, for the exact conversion
+        Big_Integer exact{};
+        size_t count = 0;
+        for (size_t i = integer; i < fraction_end; ++i) {
+            if (i == integer_end)
+                i = fraction;
+            if (count == 0 && in_[i] == '0')
+                continue;
+            exact.multiply(10);
+            exact.add(static_cast<uint32_t>(in_[i] - '0'));
+            if (++count > 768)
+                throw "simplejson: number literal too long";
+        }
+        int magnitude = static_cast<int>(count) + scale -
+                        static_cast<int>(fraction_end - fraction);
+        double value = 0.0;
+        if (count != 0 && magnitude > 310) {
+            value = std::numeric_limits<double>::infinity();
+        } else if (count != 0 && magnitude >= -325) {
+            constexpr double powers[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                          1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                          1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                          1e18, 1e19, 1e20, 1e21, 1e22 };
+            double guess = static_cast<double>(mantissa);
+            for (int e = exponent; e != 0;) {
+                int step = e > 0 ? std::min(e, 22) : std::min(-e, 22);
+                if (e > 0 && guess >= DBL_MAX / powers[step]) {
+                    // overflow is no constant, exact_double starts at max
+                    guess = std::numeric_limits<double>::infinity();
+                    break;
+                }
+                guess = e > 0 ? guess * powers[step] : guess / powers[step];
+                e += e > 0 ? -step : step;
+            }
+            value = exact_double(
+                exact, magnitude - static_cast<int>(count), guess);
+        }
+        add(JSON::Class::Floating).floating = negative ? -value : value;
     }
-    std::cerr << "ERROR: Parse: Unknown starting character '" << value << "'\n";
-    return JSON();
-}
 
-}
+    std::string_view in_;
+    size_t pos_ = 0;
+    size_t bytes_ = 0;
+    std::array<size_t, D + 1> stack_{};
+    size_t top_ = 0;
+    uint32_t key_ = 0;
+    uint32_t key_length_ = 0;
+    Static_Document<N, B, D> doc_{};
+};
 
-///////////////////////
-// Main API functions
-//////////////////////
+} // namespace detail
 
-inline JSON JSON::load(std::string_view str) noexcept
+namespace literals {
+
+// compile-time JSON literal, e.g. R"({"retries": 3})"_json
+template<detail::Fixed_String S>
+consteval auto operator""_json()
 {
-    size_t offset = 0;
-    return parse_next(str.data(), offset);
+    constexpr auto measure = detail::measure_static(S.view());
+    return detail::Static_Parser<std::max<size_t>(measure.nodes, 1),
+                                 std::max<size_t>(S.view().size(), 1),
+                                 measure.depth>(S.view())
+        .parse();
 }
 
-inline JSON JSON::load_file(std::string_view path)
-{
-    namespace fs = std::filesystem;
-    std::ifstream f(path.data(), std::ios::in | std::ios::binary);
-    const auto sz = fs::file_size(path);
-    std::string result(sz, '\0');
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wsign-conversion"
-    f.read(result.data(), sz);
-#pragma GCC diagnostic pop
+} // namespace literals
 
-    return JSON::load(result);
-}
+#endif
 
 } // namespace json
+
+template<>
+struct std::hash<json::JSON>
+{
+    size_t operator()(json::JSON const& value) const noexcept
+    {
+        return value.hash();
+    }
+};
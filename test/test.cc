@@ -6,13 +6,16 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cctype>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory_resource>
 #include <simplejson.h>
 #include <string_view>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -151,6 +154,19 @@ TEST_CASE_METHOD(JSON_Fixture, "JSON::load")
     REQUIRE(trim_string(obj) == trim_string(object_string));
 }
 
+TEST_CASE("JSON::load max_depth")
+{
+    json::Options options{};
+    options.max_depth = 3;
+    REQUIRE(json::JSON::load("[[[1]]]", options).size() == 1);
+    REQUIRE(json::JSON::load("[[[[1]]]]", options).is_null());
+    REQUIRE(json::JSON::load(R"({"a":{"b":{"c":{}}}})", options).is_null());
+
+    const size_t depth = 100000;
+    std::string deep = std::string(depth, '[') + std::string(depth, ']');
+    REQUIRE(json::JSON::load(deep).is_null());
+}
+
 TEST_CASE_METHOD(JSON_Fixture, "JSON::load_file")
 {
     json::JSON test_1 = json::JSON::load_file("./test/cases/test.json");
@@ -217,7 +233,7 @@ TEST_CASE_METHOD(JSON_Fixture, "JSON::to_map")
 
 TEST_CASE_METHOD(JSON_Fixture, "JSON::object_range")
 {
-    auto expected = std::array<std::string, 3>{ "a", "b", "c" };
+    auto expected = std::array<std::string_view, 3>{ "a", "b", "c" };
     size_t index = 0;
     for (auto const& test : object_test.object_range()) {
         REQUIRE(test.first == expected[index]);
@@ -331,10 +347,1276 @@ TEST_CASE_METHOD(JSON_Fixture, "JSON::dump")
 
 TEST_CASE_METHOD(JSON_Fixture, "JSON::dump_keys")
 {
-    auto expected = std::array<std::string, 3>{ "a", "b", "c" };
+    auto expected = std::array<std::string_view, 3>{ "a", "b", "c" };
     size_t index = 0;
     for (auto const& key : object_test.dump_keys()) {
         REQUIRE(key == expected[index]);
         index++;
     }
 }
+
+TEST_CASE("JSON deep documents")
+{
+    json::Options options{};
+    options.max_depth = 200000;
+    std::string deep = std::string(options.max_depth, '[') +
+                       std::string(options.max_depth, ']');
+
+    auto test = json::JSON::load(deep, options);
+    auto test_2 = json::JSON::load(deep, options);
+    REQUIRE(test == test_2);
+    REQUIRE(test.hash() == test_2.hash());
+    REQUIRE(trim_string(test.dump()) == deep);
+
+    test = json::JSON(1);
+    REQUIRE(test.JSON_type() == json::JSON::Class::Integral);
+}
+
+TEST_CASE("JSON::hash")
+{
+    auto test = json::JSON::load(R"({"a":[1,[2]],"b":"c"})");
+    REQUIRE(test.hash() ==
+            json::JSON::load(R"({"b":"c","a":[1,[2]]})").hash());
+    REQUIRE(test.hash() != json::JSON::load(R"({"a":[[1,2]],"b":"c"})").hash());
+    REQUIRE(std::hash<json::JSON>{}(json::JSON(1)) == json::JSON(1).hash());
+    REQUIRE(json::JSON(1) != json::JSON(1.0));
+}
+
+TEST_CASE("json::walk")
+{
+    struct Counter
+    {
+        size_t values = 0;
+        size_t containers = 0;
+        bool enter(json::JSON const&, std::pmr::string const*)
+        {
+            ++values;
+            return true;
+        }
+        void leave(json::JSON const&) { ++containers; }
+    };
+    Counter counter{};
+    json::walk(json::JSON::load(R"({"a":[1,{"b":null}],"c":true})"), counter);
+    REQUIRE(counter.values == 6);
+    REQUIRE(counter.containers == 3);
+}
+
+TEST_CASE("JSON::load projection")
+{
+    const std::string input = R"({
+        "id" : 7,
+        "junk" : { "a" : [1, 2, { "b" : "}]\"" }] },
+        "user" : { "name" : "bo", "age" : 3 },
+        "items" : [ { "price" : 2, "sku" : "x" }, { "price" : 3 } ]
+    })";
+
+    auto test = json::JSON::load(
+        input, json::Projection{ "id", "user.name", "items[*].price" });
+    auto expected = json::JSON::load(R"({
+        "id" : 7,
+        "user" : { "name" : "bo" },
+        "items" : [ { "price" : 2 }, { "price" : 3 } ]
+    })");
+
+    REQUIRE(test == expected);
+    REQUIRE(test.has_key("junk") == false);
+    REQUIRE(json::JSON::load(input, json::Projection{ "missing" }).size() ==
+            0);
+    REQUIRE(json::JSON::load("[{\"a\":1,\"b\":2}]", json::Projection{ "[*].a" })
+                .at(0)
+                .size() == 1);
+
+    auto escaped = json::JSON::load(R"({"q\"t" : 1, "n" : 2})",
+                                    json::Projection{ "q\"t" });
+    REQUIRE(escaped == json::JSON::load(R"({"q\"t" : 1})"));
+    REQUIRE(escaped.dump() == json::JSON::load(R"({"q\"t" : 1})").dump());
+
+    using Code = json::Parse_Error::Code;
+    json::Parse_Error error{};
+    json::Projection name{ "user.name" };
+    REQUIRE(json::JSON::load(R"({"user": {"name": tru}})", name, error)
+                .is_null());
+    REQUIRE(error.code == Code::invalid_literal);
+    REQUIRE(error.offset == 18);
+    REQUIRE(json::JSON::load(R"({"user": {}} {)", name, error).is_null());
+    REQUIRE(error.code == Code::trailing_content);
+    REQUIRE(json::JSON::load(R"({"id": 01, "user": {}})", name, error)
+                .is_null());
+    REQUIRE(error.code == Code::invalid_number);
+    REQUIRE(json::JSON::load(R"({"user": {"name": 1}})", name, error)
+                .size() == 1);
+    REQUIRE(!error);
+}
+
+TEST_CASE("json::Path")
+{
+    const std::string input = R"({
+        "events" : [ { "user" : { "id" : 1 } },
+                     { "user" : { "id" : 2 } },
+                     { "x" : { "user" : { "id" : 3 } } } ],
+        "book" : [ { "price" : 8, "t" : "a" },
+                   { "price" : 12, "t" : "b" },
+                   { "price" : 5, "t" : "c" } ]
+    })";
+
+    auto ids = json::Path::compile("$.events[*].user.id")->query(input);
+    REQUIRE(ids.size() == 2);
+    REQUIRE(ids[0] == json::JSON(1));
+    REQUIRE(ids[1] == json::JSON(2));
+
+    REQUIRE(json::Path::compile("$..id")->query(input).size() == 3);
+    REQUIRE(json::Path::compile("$.book[-1].t")->query(input)[0] ==
+            json::JSON("c"));
+    REQUIRE(json::Path::compile("$.book[0:2].price")->query(input).size() ==
+            2);
+
+    auto cheap = json::Path::compile("$.book[?(@.price < 10)].t");
+    auto titles = cheap->query(input);
+    REQUIRE(titles.size() == 2);
+    REQUIRE(titles[1] == json::JSON("c"));
+
+    auto ranges = json::Path::compile("$.events[1]")->query_ranges(input);
+    REQUIRE(ranges.size() == 1);
+    REQUIRE(input.substr(ranges[0].first,
+                         ranges[0].second - ranges[0].first) ==
+            R"({ "user" : { "id" : 2 } })");
+
+    REQUIRE_FALSE(json::Path::compile("events").has_value());
+    REQUIRE_FALSE(json::Path::compile("$[99999999999999999999]").has_value());
+    REQUIRE_FALSE(json::Path::compile("$[0:-99999999999999999999]"));
+    REQUIRE_FALSE(
+        json::Path::compile("$.a")->for_each("{\"a\": [1,", [](auto) {}));
+}
+
+struct Bind_Item
+{
+    double price{};
+    std::string sku{};
+};
+
+struct Bind_Order
+{
+    long id{};
+    std::optional<std::string> note{};
+    std::vector<Bind_Item> items{};
+};
+
+SIMPLEJSON_BINDING(Bind_Item,
+                   json::field("price", &Bind_Item::price),
+                   json::field("sku", &Bind_Item::sku))
+
+SIMPLEJSON_BINDING(Bind_Order,
+                   json::field("id", &Bind_Order::id),
+                   json::field("note", &Bind_Order::note),
+                   json::field("items", &Bind_Order::items))
+
+TEST_CASE("json::read")
+{
+    Bind_Order order{};
+    auto errors = json::read(R"({
+        "id" : 42,
+        "unknown" : { "a" : [1, "}"] },
+        "items" : [ { "price" : 1.5, "sku" : "a" }, { "price" : "x" } ]
+    })",
+                             order);
+
+    REQUIRE(order.id == 42);
+    REQUIRE_FALSE(order.note.has_value());
+    REQUIRE(order.items.size() == 2);
+    REQUIRE(order.items[0].price == 1.5);
+    REQUIRE(order.items[0].sku == "a");
+    REQUIRE(errors.size() == 2);
+    REQUIRE(errors[0].path == "/items/1/price");
+    REQUIRE(errors[1].path == "/items/1/sku");
+    REQUIRE(errors[1].message == "Missing field");
+
+    REQUIRE(json::read("{\"id\": 1,", order).size() == 1);
+}
+
+TEST_CASE("json::write")
+{
+    Bind_Order order{ 7, "gift", { { 2.5, "b" } } };
+    json::Writer writer{};
+    json::write(order, writer);
+
+    REQUIRE(json::JSON::load(writer.str()) ==
+            json::JSON::load(R"({
+                "id" : 7,
+                "note" : "gift",
+                "items" : [ { "price" : 2.5, "sku" : "b" } ]
+            })"));
+}
+
+TEST_CASE("json::Schema")
+{
+    auto schema = json::Schema::compile(json::JSON::load(R"({
+        "type" : "object",
+        "required" : [ "id", "items" ],
+        "additionalProperties" : false,
+        "properties" : {
+            "id" : { "type" : "integer", "minimum" : 1 },
+            "kind" : { "enum" : [ "retail", "wholesale" ] },
+            "tags" : {
+                "type" : "array",
+                "items" : { "type" : "string", "maxLength" : 3 },
+                "uniqueItems" : true
+            },
+            "items" : {
+                "type" : "array",
+                "minItems" : 1,
+                "items" : { "$ref" : "#/$defs/item" }
+            }
+        },
+        "$defs" : {
+            "item" : {
+                "type" : "object",
+                "required" : [ "price" ],
+                "properties" : {
+                    "price" : { "type" : "number", "exclusiveMinimum" : 0 }
+                }
+            }
+        }
+    })"));
+    REQUIRE(schema.has_value());
+
+    auto error_at = [&](std::string const& input) {
+        auto error = schema->validate(input);
+        return error ? error->path + " " + error->message : std::string("ok");
+    };
+    REQUIRE(error_at(R"({"id": 1, "items": [{"price": 2.5}]})") == "ok");
+    REQUIRE(error_at(R"({"id": 1, "kind": "b2b", "items": [{"price": 1}]})") ==
+            "/kind Value is not one of the allowed values");
+    REQUIRE(error_at(R"({"id": 0, "items": [{"price": 1}]})") ==
+            "/id Number is below the minimum");
+    REQUIRE(error_at(R"({"id": 1.5, "items": [{"price": 1}]})") ==
+            "/id Expected integer");
+    REQUIRE(error_at(R"({"id": 1, "items": [{"price": 0}]})") ==
+            "/items/0/price Number is below the minimum");
+    REQUIRE(error_at(R"({"id": 1, "items": [{}]})") ==
+            "/items/0 Missing required property \"price\"");
+    REQUIRE(error_at(R"({"id": 1, "items": []})") == "/items Too few items");
+    REQUIRE(error_at(R"({"id": 1, "items": [{"price": 1}], "x": 1})") ==
+            "/x Value is not allowed");
+    REQUIRE(error_at(R"({"id": 1, "items": [{"price": 1}], "tags": [1]})") ==
+            "/tags/0 Unexpected number");
+    REQUIRE(error_at(R"({"tags": ["a", "a"], "id": 1, "items": []})") ==
+            "/tags Array items are not unique");
+
+    auto error = schema->validate(R"({"id": 1, "items": [{"price": -1}]})");
+    REQUIRE(error.has_value());
+    REQUIRE(error->offset == 30);
+
+    auto choice = json::Schema::compile(json::JSON::load(R"({
+        "anyOf" : [ { "type" : "string" }, { "type" : "integer" } ],
+        "not" : { "const" : 3 }
+    })"));
+    REQUIRE_FALSE(choice->validate("\"x\"").has_value());
+    REQUIRE_FALSE(choice->validate("4").has_value());
+    REQUIRE(choice->validate("3").has_value());
+    REQUIRE(choice->validate("null").has_value());
+
+    // numbers compare by value, also inside arrays and objects
+    auto numeric = json::Schema::compile(json::JSON::load(R"({
+        "properties" : {
+            "n" : { "enum" : [ 1, 2.5, [ 3.0, { "k" : 4 } ] ] },
+            "c" : { "const" : 1 },
+            "u" : { "uniqueItems" : true }
+        }
+    })"));
+    REQUIRE(numeric.has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"n": 1.0})").has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"n": 2.5e0})").has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"n": [3, {"k": 4.0}]})").has_value());
+    REQUIRE(numeric->validate(R"({"n": 1.5})").has_value());
+    REQUIRE(numeric->validate(R"({"n": [3, {"k": 5}]})").has_value());
+    REQUIRE(numeric->validate(R"({"n": "1"})").has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"c": 1.0})").has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"c": 10e-1})").has_value());
+    REQUIRE(numeric->validate(R"({"c": true})").has_value());
+    REQUIRE(numeric->validate(R"({"u": [1, 1.0]})").has_value());
+    REQUIRE_FALSE(numeric->validate(R"({"u": [1, 1.5]})").has_value());
+
+    REQUIRE_FALSE(json::Schema::compile(json::JSON::load(R"({
+        "type" : "strin"
+    })")).has_value());
+    REQUIRE_FALSE(json::Schema::compile(json::JSON::load(R"({
+        "$ref" : "#/$defs/missing"
+    })")).has_value());
+}
+
+TEST_CASE("JSON::freeze")
+{
+    json::JSON source = json::JSON::load(R"({
+        "name" : "caf\u00e9",
+        "limits" : { "cpu" : 1.5, "memory" : 512, "burst" : true },
+        "hosts" : [ "a", "b", [ null ] ],
+        "quo\"te" : 1
+    })");
+    const json::Frozen_Document frozen = source.freeze();
+
+    REQUIRE(frozen.size() == 4);
+    REQUIRE(frozen["limits"]["cpu"].to_float() == 1.5);
+    REQUIRE(frozen["limits"]["memory"].to_int() == 512);
+    REQUIRE(frozen["limits"]["burst"].to_bool());
+    REQUIRE(frozen["hosts"][1].to_string() == "b");
+    REQUIRE(frozen["hosts"][2][0].is_null());
+    REQUIRE(frozen["quo\"te"].to_int() == 1);
+    REQUIRE(frozen["missing"]["deeper"].is_null());
+    REQUIRE(frozen["hosts"][7].is_null());
+    REQUIRE(frozen.to_json() == source);
+
+    // integers beyond a long are kept as text
+    json::JSON big = json::JSON::load(R"({"big": 123456789012345678901234567890,
+                                          "u": 18446744073709551615})");
+    auto frozen_big = big.freeze();
+    REQUIRE(frozen_big["big"].to_int() == 0);
+    REQUIRE(frozen_big["big"].raw_number() == "123456789012345678901234567890");
+    REQUIRE(frozen_big["u"].raw_number() == "18446744073709551615");
+    REQUIRE(frozen_big["u"].to_json().to_uint() == ULONG_MAX);
+    REQUIRE(frozen_big.to_json().dump() == big.dump());
+    REQUIRE(frozen["limits"]["memory"].raw_number() == "512");
+
+    std::vector<std::thread> readers{};
+    std::atomic<long> total{ 0 };
+    for (int i = 0; i < 4; ++i)
+        readers.emplace_back([&] {
+            long sum = 0;
+            for (int n = 0; n < 1000; ++n)
+                sum += frozen["limits"]["memory"].to_int() +
+                       static_cast<long>(frozen["hosts"].size());
+            total += sum;
+        });
+    for (auto& reader : readers)
+        reader.join();
+    REQUIRE(total == 4 * 1000 * 515);
+}
+
+TEST_CASE("json::Mapped_Document")
+{
+    json::JSON source = json::JSON::load(R"({
+        "zone" : "eu",
+        "limits" : { "cpu" : 1.5, "memory" : 512, "burst" : true },
+        "hosts" : [ "a", "b", [ null ] ],
+        "quo\"te" : 1
+    })");
+    const fs::path path =
+        fs::temp_directory_path() / "mapped_document_test.snapshot";
+    REQUIRE(source.save_snapshot(path.string()));
+
+    auto mapped = json::Mapped_Document::open(path.string());
+    REQUIRE(mapped);
+    REQUIRE(mapped->size() == 4);
+    REQUIRE((*mapped)["limits"]["memory"].to_int() == 512);
+    REQUIRE((*mapped)["limits"]["burst"].to_bool());
+    REQUIRE((*mapped)["hosts"][1].to_string() == "b");
+    REQUIRE((*mapped)["hosts"][2][0].is_null());
+    REQUIRE((*mapped)["quo\"te"].to_int() == 1);
+    REQUIRE((*mapped)["missing"].is_null());
+    REQUIRE((*mapped)["limits"]["zzz"].is_null());
+    REQUIRE((*mapped)["hosts"][3].is_null());
+    REQUIRE(mapped->to_json() == source);
+
+    // copies share the mapping
+    json::Mapped_Document copy = *mapped;
+    mapped.reset();
+    REQUIRE(copy["zone"].to_string() == "eu");
+    fs::remove(path);
+
+    // in-memory snapshots, rejected when truncated
+    auto bytes = source.freeze().snapshot();
+    REQUIRE(json::Mapped_Document::view(bytes.data(), bytes.size()));
+    REQUIRE_FALSE(json::Mapped_Document::view(bytes.data(), bytes.size() - 1));
+    REQUIRE_FALSE(json::Mapped_Document::view(bytes.data(), 10));
+    REQUIRE_FALSE(json::Mapped_Document::open("no/such/file.snapshot"));
+
+    // failures are reported through Snapshot_Error
+    using Code = json::Snapshot_Error::Code;
+    json::Snapshot_Error error{};
+    REQUIRE_FALSE(json::Mapped_Document::open("no/such/file.snapshot", error));
+    REQUIRE(error.code == Code::cannot_read);
+    REQUIRE_FALSE(json::Mapped_Document::view(bytes.data(), 10, error));
+    REQUIRE(error.code == Code::truncated);
+    REQUIRE_FALSE(source.save_snapshot("no/such/dir/out.snapshot", error));
+    REQUIRE(error.code == Code::cannot_write);
+    REQUIRE(error.message() == "Cannot write the snapshot file");
+    std::vector<char> copied(bytes);
+    copied[0] = 'X';
+    REQUIRE_FALSE(
+        json::Mapped_Document::view(copied.data(), copied.size(), error));
+    REQUIRE(error.code == Code::not_a_snapshot);
+    REQUIRE(json::Mapped_Document::view(bytes.data(), bytes.size(), error));
+    REQUIRE_FALSE(error);
+
+    // corrupt tables are rejected on open, or read within bounds
+    size_t rejected = 0;
+    for (size_t i = 64; i < bytes.size(); ++i) {
+        for (int value : { 0x00, 0x01, 0xff }) {
+            std::vector<char> corrupt(bytes);
+            corrupt[i] = static_cast<char>(value);
+            auto document = json::Mapped_Document::view(
+                corrupt.data(), corrupt.size(), error);
+            if (!document) {
+                REQUIRE(error.code == Code::corrupt);
+                ++rejected;
+                continue;
+            }
+            document->to_json();
+            (*document)["limits"]["memory"].to_int();
+            (*document)["hosts"][2][0].is_null();
+        }
+    }
+    REQUIRE(rejected > 0);
+}
+
+TEST_CASE("json::Tape_Document")
+{
+    const std::string input = R"({
+        "id" : 7,
+        "user" : { "name" : "café", "roles" : [ "admin", "ops" ] },
+        "ts" : 1700000000.25,
+        "quo\"te" : true,
+        "empty" : [ {}, [] ],
+        "n" : null
+    })";
+    auto document = json::Tape_Document::load(input);
+
+    REQUIRE(document.size() == 6);
+    REQUIRE(document["id"].to_int() == 7);
+    REQUIRE(document.at("user").at("roles").at(1).to_string() == "ops");
+    REQUIRE(document["user"]["name"].to_string() == "caf\xc3\xa9");
+    REQUIRE(document["ts"].to_float() == 1700000000.25);
+    REQUIRE(document["quo\"te"].to_bool());
+    REQUIRE(document["empty"][0].size() == 0);
+    REQUIRE(document["n"].is_null());
+    REQUIRE(document.root().has_key("n"));
+    REQUIRE_FALSE(document.root().has_key("missing"));
+    REQUIRE(document["missing"]["deeper"].is_null());
+    REQUIRE(document["user"]["roles"][2].is_null());
+    REQUIRE(document.to_json() == json::JSON::load(input));
+    REQUIRE(document["user"].to_json() == json::JSON::load(input)["user"]);
+
+    std::vector<std::string> keys{};
+    for (auto [key, value] : document.root().object_range())
+        if (value.JSON_type() != json::JSON::Class::Null)
+            keys.emplace_back(key);
+    REQUIRE(keys == std::vector<std::string>{
+                        "id", "user", "ts", "quo\"te", "empty" });
+    size_t roles = 0;
+    for (auto role : document["user"]["roles"].array_range())
+        roles += role.to_string().size();
+    REQUIRE(roles == 8);
+    REQUIRE(document["id"].array_range().begin() ==
+            document["id"].array_range().end());
+
+    REQUIRE(json::Tape_Document::load("[1, 2").is_null());
+    REQUIRE(json::Tape_Document::load("\"a").is_null());
+    REQUIRE(json::Tape_Document::load("-3").root().to_int() == -3);
+    REQUIRE(json::Tape_Document::load("[[1]]", json::Options{ 1 }).is_null());
+
+    using Code = json::Parse_Error::Code;
+    json::Parse_Error error{};
+    REQUIRE(json::Tape_Document::load("[1] ]", error).is_null());
+    REQUIRE(error.code == Code::trailing_content);
+    REQUIRE(error.offset == 4);
+    REQUIRE(json::Tape_Document::load("[01]", error).is_null());
+    REQUIRE(error.code == Code::invalid_number);
+    REQUIRE(json::Tape_Document::load(" [0.5] \n", error).size() == 1);
+    REQUIRE(!error);
+
+    // numbers and strings are read as JSON::load reads them
+    const std::string big = R"({"n": [123456789012345678901234567890, 2]})";
+    auto numbers = json::Tape_Document::load(big);
+    REQUIRE(numbers["n"][0].JSON_type() == json::JSON::Class::Integral);
+    REQUIRE(numbers["n"][0].to_int() == 0);
+    REQUIRE(numbers["n"][0].raw_number() == "123456789012345678901234567890");
+    REQUIRE(numbers["n"][1].to_int() == 2);
+    REQUIRE(numbers.to_json().dump() == json::JSON::load(big).dump());
+    REQUIRE(json::Tape_Document::load("[\"\xff\"]", error).is_null());
+    REQUIRE(error.code == Code::invalid_utf8);
+    REQUIRE(error.offset == 2);
+    REQUIRE(json::Tape_Document::load(R"({"a\x": 1})", error).is_null());
+    REQUIRE(error.code == Code::invalid_escape);
+    REQUIRE(error.offset == 3);
+}
+
+TEST_CASE("json::Atomic_Document")
+{
+    json::Atomic_Document live{};
+    REQUIRE(live.snapshot()->JSON_type() == json::JSON::Class::Null);
+
+    live.publish(json::JSON::load(R"({ "version" : 0, "copy" : 0 })"));
+    auto pinned = live.snapshot();
+
+    std::atomic<bool> done{ false };
+    std::atomic<long> mismatches{ 0 };
+    std::vector<std::thread> readers{};
+    for (int i = 0; i < 4; ++i)
+        readers.emplace_back([&] {
+            while (!done) {
+                auto snapshot = live.snapshot();
+                if (snapshot["version"].to_int() != snapshot["copy"].to_int())
+                    ++mismatches;
+            }
+        });
+    for (long version = 1; version <= 200; ++version) {
+        json::JSON document = json::object();
+        document["version"] = version;
+        document["copy"] = version;
+        live.publish(document);
+    }
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(live.snapshot()["version"].to_int() == 200);
+
+    // more snapshots than hazard records grow the list instead of waiting
+    json::Atomic_Document small(json::Frozen_Document{}, 1);
+    std::vector<json::Atomic_Document::Snapshot> held{};
+    for (int i = 0; i < 8; ++i)
+        held.push_back(small.snapshot());
+    small.publish(json::JSON::load("[1]"));
+    REQUIRE(held.front()->is_null());
+    REQUIRE(small.snapshot()->size() == 1);
+    // a held snapshot keeps its document alive across publishes
+    REQUIRE(pinned["version"].to_int() == 0);
+}
+
+TEST_CASE("json::Parser")
+{
+    json::Parser parser{};
+    const std::string message = R"({
+        "id" : 7,
+        "user" : { "name" : "alice", "roles" : [ "admin", "ops" ] },
+        "ts" : 1700000000.25,
+        "note" : "line\nbreak",
+        "n" : null
+    })";
+
+    auto const& document = parser.parse(message);
+    REQUIRE(document["id"].to_int() == 7);
+    REQUIRE(document["user"]["roles"][1].to_string() == "ops");
+    REQUIRE(document["ts"].to_float() == 1700000000.25);
+    REQUIRE(document["note"].to_string() == "line\nbreak");
+    REQUIRE(document.to_json() == json::JSON::load(message));
+
+    // steady state reuses the tables of the previous parse
+    size_t memory = document.memory_usage();
+    REQUIRE(&parser.parse(message) == &document);
+    REQUIRE(document.memory_usage() == memory);
+
+    REQUIRE(parser.parse("[1, 2").JSON_type() == json::JSON::Class::Null);
+    REQUIRE(parser.parse("[1, 2]").size() == 2);
+
+    json::Parser shallow(json::Options{ 2 });
+    REQUIRE(shallow.parse("[[1]]").size() == 1);
+    REQUIRE(shallow.parse("[[[1]]]").is_null());
+
+    // a malformed message is told apart from a literal null
+    using Code = json::Parse_Error::Code;
+    json::Parse_Error error{};
+    REQUIRE(parser.parse("null", error).is_null());
+    REQUIRE(!error);
+    REQUIRE(parser.parse("{\"a\": [1, {\"b~\": tru}]}", error).is_null());
+    REQUIRE(error.code == Code::invalid_literal);
+    REQUIRE(error.offset == 17);
+    REQUIRE(error.column == 18);
+    REQUIRE(error.pointer == "/a/1/b~0");
+    REQUIRE(parser.parse("{\"a\": 1,\n 2}", error).is_null());
+    REQUIRE(error.code == Code::expected_key);
+    REQUIRE(error.line == 2);
+    REQUIRE(error.pointer.empty());
+    REQUIRE(parser.parse("1 2", error).is_null());
+    REQUIRE(error.code == Code::trailing_content);
+    REQUIRE(error.offset == 2);
+    REQUIRE(parser.parse("[-01]", error).is_null());
+    REQUIRE(error.code == Code::invalid_number);
+    REQUIRE(parser.parse("[0, -0.5]\n", error).size() == 2);
+
+    // integers beyond a long keep their text, as JSON::load does
+    const std::string big = "[18446744073709551615, -1]";
+    REQUIRE(parser.parse(big)[0].raw_number() == "18446744073709551615");
+    REQUIRE(parser.parse(big)[0].to_int() == 0);
+    REQUIRE(parser.parse(big).to_json().dump() ==
+            json::JSON::load(big).dump());
+
+    // string failures keep their own code and offset
+    REQUIRE(parser.parse("[\"ok\", \"\xff\"]", error).is_null());
+    REQUIRE(error.code == Code::invalid_utf8);
+    REQUIRE(error.offset == 8);
+    REQUIRE(parser.parse("[\"\\n\xff\"]", error).is_null());
+    REQUIRE(error.code == Code::invalid_utf8);
+    REQUIRE(error.offset == 4);
+    REQUIRE(parser.parse(R"({"k\q": 1})", error).is_null());
+    REQUIRE(error.code == Code::invalid_escape);
+    REQUIRE(error.offset == 3);
+    REQUIRE(parser.parse(R"(["\u00e9\ud83d"])", error).is_null());
+    REQUIRE(error.code == Code::unpaired_surrogate);
+    REQUIRE(error.offset == 8);
+    REQUIRE(parser.parse(R"(["caf\u00e9"])")[0].to_string() == "caf\u00e9");
+}
+
+TEST_CASE("JSON::load lazy_numbers")
+{
+    const std::string input = R"({
+        "id" : 18446744073709551615,
+        "huge" : 123456789012345678901234567890,
+        "pi" : 3.14159265358979323846,
+        "n" : -5,
+        "e" : 12.5e3
+    })";
+    json::Options options{};
+    options.lazy_numbers = true;
+    json::JSON lazy = json::JSON::load(input, options);
+
+    REQUIRE(lazy["id"].JSON_type() == json::JSON::Class::Integral);
+    REQUIRE(lazy["id"].to_uint() == 18446744073709551615UL);
+    REQUIRE(lazy["id"].to_int() == 0);
+    REQUIRE(lazy["huge"].raw_number() == "123456789012345678901234567890");
+    REQUIRE(lazy["pi"].raw_number() == "3.14159265358979323846");
+    REQUIRE(lazy["n"].to_int() == -5);
+    REQUIRE(lazy["e"].to_float() == 12500.0);
+
+    // dump emits the source text, so the document round-trips exactly
+    REQUIRE(lazy.dump().find("123456789012345678901234567890") !=
+            std::string::npos);
+    REQUIRE(json::JSON::load(lazy.dump(), options) == lazy);
+
+    json::JSON eager = json::JSON::load(input);
+    REQUIRE(eager["n"] == lazy["n"]);
+    REQUIRE(eager["n"].hash() == lazy["n"].hash());
+    REQUIRE(eager["e"] == lazy["e"]);
+    // integers beyond a long keep their text without lazy_numbers too
+    REQUIRE(eager["id"] == lazy["id"]);
+    REQUIRE(eager["id"].to_uint() == 18446744073709551615UL);
+    REQUIRE(eager["id"].dump() == "18446744073709551615");
+    REQUIRE(json::JSON::load("[18446744073709551615, 1]").dump() ==
+            "[18446744073709551615, 1]");
+    REQUIRE(json::JSON::load("-9223372036854775808").to_int() == LONG_MIN);
+    REQUIRE(eager["n"].raw_number() == "-5");
+
+    lazy["n"] = 7;
+    REQUIRE(lazy["n"].to_int() == 7);
+    REQUIRE(lazy["n"].raw_number() == "7");
+}
+
+TEST_CASE("JSON::load unicode")
+{
+    json::JSON decoded = json::JSON::load(
+        R"(["caf\u00e9", "\ud83d\ude00", "\u0001", "\u00E9t\u00e9"])");
+    REQUIRE(decoded[0] == json::JSON("caf\xc3\xa9"));
+    REQUIRE(decoded[1] == json::JSON("\xf0\x9f\x98\x80"));
+    REQUIRE(decoded[3] == json::JSON("\xc3\xa9t\xc3\xa9"));
+    // control characters are escaped again on output
+    REQUIRE(decoded[2].dump() == "\"\\u0001\"");
+    REQUIRE(json::JSON::load(decoded.dump()) == decoded);
+
+    REQUIRE(json::JSON::load("[\"caf\xc3\xa9\"]")[0] == decoded[0]);
+
+    // lone surrogates, bad hex, malformed UTF-8 and bad escapes fail
+    REQUIRE(json::JSON::load(R"(["\ud83d"])").is_null());
+    REQUIRE(json::JSON::load(R"(["\ude00"])").is_null());
+    REQUIRE(json::JSON::load(R"(["\u12G4"])").is_null());
+    REQUIRE(json::JSON::load(R"(["\q"])").is_null());
+    REQUIRE(json::JSON::load("[\"\xc3\"]").is_null());
+    REQUIRE(json::JSON::load("[\"\xed\xa0\x80\"]").is_null());
+    REQUIRE(json::JSON::load("[\"\xf4\x90\x80\x80\"]").is_null());
+    REQUIRE(json::JSON::load("{\"\xff\": 1}").is_null());
+    REQUIRE(json::JSON::load("[\"open").is_null());
+}
+
+TEST_CASE("JSON::load long strings")
+{
+    // place an escape, a multi-byte character and the closing quote at
+    // every offset around the 16 and 32 byte block boundaries
+    for (size_t length = 0; length < 70; ++length) {
+        std::string body(length, 'a');
+        std::string input = "[\"" + body + "\\n" + body + "\xc3\xa9\"]";
+        json::JSON parsed = json::JSON::load(input);
+        REQUIRE(parsed[0] == json::JSON(body + "\n" + body + "\xc3\xa9"));
+        REQUIRE(json::JSON::load("[\"" + body + "\xc3\"]").is_null());
+        REQUIRE(json::JSON::load("[\"" + body + "\t\"]").is_null());
+    }
+    // malformed sequences after long valid multi-byte runs are reported
+    // at their first byte wherever they fall in a vector block
+    std::string euro;
+    for (int i = 0; i < 30; ++i)
+        euro += "\xe2\x82\xac";
+    for (std::string bad : { "\xc3", "\xe0\x80\x80", "\xed\xa0\x80", "\x80",
+                             "\xf4\x90\x80\x80", "\xc0\xaf", "\xe2\x82" }) {
+        for (size_t length = 0; length < 70; ++length) {
+            std::string body =
+                euro.substr(0, 3 * (length % 30)) + std::string(length, 'a');
+            auto parsed =
+                json::JSON::try_load("[\"" + body + bad + "\u00e9\"]");
+            REQUIRE(parsed.error.code == json::Parse_Error::Code::invalid_utf8);
+            REQUIRE(parsed.error.offset == 2 + body.size());
+        }
+    }
+    std::string blob(1 << 16, 'Q');
+    REQUIRE(json::JSON::load("{\"blob\": \"" + blob + "\"}")["blob"] ==
+            json::JSON(blob));
+}
+
+TEST_CASE("JSON short strings")
+{
+    // 15 bytes are kept in the node, 16 go to the heap
+    std::string inline_text(json::detail::Short_String::capacity, 's');
+    std::string heap_text = inline_text + "h";
+    json::JSON small(inline_text);
+    json::JSON large(heap_text);
+    REQUIRE(!small.Internal.String);
+    REQUIRE(large.Internal.String);
+    REQUIRE(small.text() == inline_text);
+    REQUIRE(large.text() == heap_text);
+    REQUIRE(json::JSON("a\"b").to_string() == "a\\\"b");
+    REQUIRE(json::JSON("").text().empty());
+    REQUIRE(json::JSON(5).text().empty());
+
+    REQUIRE(small == json::JSON(inline_text));
+    REQUIRE(small != large);
+    REQUIRE(small.hash() == json::JSON(inline_text).hash());
+    REQUIRE(json::JSON::load(small.dump()) == small);
+
+    // assignment switches storage in both directions
+    json::JSON value(heap_text);
+    value = "x";
+    REQUIRE(!value.Internal.String);
+    REQUIRE(value.text() == "x");
+    value = heap_text;
+    REQUIRE(value.text() == heap_text);
+
+    json::JSON parsed =
+        json::JSON::load(R"(["tiny", "a string past sixteen"])");
+    REQUIRE(!parsed[0].Internal.String);
+    REQUIRE(parsed[1].Internal.String);
+    REQUIRE(parsed[0].to_string() == "tiny");
+}
+
+TEST_CASE("JSON::try_load")
+{
+    using Code = json::Parse_Error::Code;
+    auto ok = json::JSON::try_load("[1, null]");
+    REQUIRE(ok);
+    REQUIRE(ok.value[0].to_int() == 1);
+    auto null = json::JSON::try_load("null");
+    REQUIRE(null);
+    REQUIRE(null.value.is_null());
+
+    auto literal = json::JSON::try_load(R"({"a": [1, 2, tru]})");
+    REQUIRE(!literal);
+    REQUIRE(literal.value.is_null());
+    REQUIRE(literal.error.code == Code::invalid_literal);
+    REQUIRE(literal.error.offset == 13);
+    REQUIRE(literal.error.line == 1);
+    REQUIRE(literal.error.column == 14);
+    REQUIRE(literal.error.pointer == "/a/2");
+
+    auto lines = json::JSON::try_load("{\n  \"a\": 1,\n  \"b\": }");
+    REQUIRE(lines.error.code == Code::unexpected_character);
+    REQUIRE(lines.error.line == 3);
+    REQUIRE(lines.error.column == 8);
+    REQUIRE(lines.error.pointer == "/b");
+    REQUIRE(lines.error.message() == "Unexpected character");
+
+    // a failed key points at the object holding it
+    auto key = json::JSON::try_load(R"({"a~/b": {"c" 1}})");
+    REQUIRE(key.error.code == Code::expected_colon);
+    REQUIRE(key.error.pointer == "/a~0~1b");
+
+    REQUIRE(json::JSON::try_load("[1, 2").error.code == Code::unexpected_end);
+    REQUIRE(json::JSON::try_load("").error.code == Code::unexpected_end);
+    REQUIRE(json::JSON::try_load("[-]").error.code == Code::invalid_number);
+    REQUIRE(json::JSON::try_load("[1.]").error.code == Code::invalid_number);
+    REQUIRE(json::JSON::try_load("[1e]").error.code == Code::invalid_number);
+    REQUIRE(json::JSON::try_load("[1 2]").error.code == Code::expected_comma);
+    REQUIRE(json::JSON::try_load("[\"\\x\"]").error.code ==
+            Code::invalid_escape);
+    REQUIRE(json::JSON::try_load("{1: 2}").error.code == Code::expected_key);
+
+    // the value must be followed by nothing but whitespace
+    auto extra = json::JSON::try_load("[1,2]]");
+    REQUIRE(extra.error.code == Code::trailing_content);
+    REQUIRE(extra.error.offset == 5);
+    REQUIRE(json::JSON::try_load("1 2").error.offset == 2);
+    REQUIRE(json::JSON::try_load(" [1] \n"));
+    // and numbers may not have leading zeros
+    REQUIRE(json::JSON::try_load("[01]").error.code == Code::invalid_number);
+    REQUIRE(json::JSON::try_load("-00").error.code == Code::invalid_number);
+    REQUIRE(json::JSON::try_load("[0, -0, 0.5, 0e1]"));
+    auto deep = json::JSON::try_load("[[1]]", json::Options{ 1 });
+    REQUIRE(deep.error.code == Code::max_depth);
+    REQUIRE(deep.error.pointer == "/0");
+
+    // the overload taking an error clears it on success
+    json::Parse_Error error{};
+    REQUIRE(json::JSON::load("[true, fals]", error).is_null());
+    REQUIRE(error.code == Code::invalid_literal);
+    REQUIRE(error.pointer == "/1");
+    REQUIRE(json::JSON::load("[true]", error).length() == 1);
+    REQUIRE(!error);
+}
+
+TEST_CASE("JSON packed arrays")
+{
+    using Code = json::Parse_Error::Code;
+    json::JSON integers = json::JSON::load("[1, -2, 3]");
+    REQUIRE(integers.as_integers().size() == 3);
+    REQUIRE(integers.as_integers()[1] == -2);
+    REQUIRE(integers.as_doubles().empty());
+    REQUIRE(integers.length() == 3);
+    REQUIRE(integers == json::array(1, -2, 3));
+    REQUIRE(json::array(1, -2, 3) == integers);
+    REQUIRE(integers.hash() == json::array(1, -2, 3).hash());
+    REQUIRE(integers.dump() == json::array(1, -2, 3).dump());
+
+    json::JSON doubles = json::JSON::load("[0.5, -2.25e1 ]");
+    double sum = 0;
+    for (double value : doubles.as_doubles())
+        sum += value;
+    REQUIRE(sum == -22.0);
+    REQUIRE(doubles.dump() == json::array(0.5, -22.5).dump());
+    REQUIRE(doubles != integers);
+    REQUIRE(doubles.to_deque().back().to_float() == -22.5);
+    REQUIRE(doubles.freeze()[1].to_float() == -22.5);
+    REQUIRE(json::JSON::load("[[1, 2], [3.5]]")[1].as_doubles().size() == 1);
+
+    // mixed arrays keep a node per element
+    json::JSON mixed = json::JSON::load(R"([1, 2, 2.5, "x"])");
+    REQUIRE(mixed.as_integers().empty());
+    REQUIRE(mixed == json::array(1, 2, 2.5, "x"));
+    REQUIRE(json::JSON::load("[1.5, 2]")[1].JSON_type() ==
+            json::JSON::Class::Integral);
+    json::Options boxed{};
+    boxed.packed_arrays = false;
+    REQUIRE(json::JSON::load("[1, 2]", boxed).as_integers().empty());
+    boxed = json::Options{};
+    boxed.lazy_numbers = true;
+    REQUIRE(json::JSON::load("[1, 2]", boxed).as_integers().empty());
+
+    // reading through nodes leaves the shared numbers and views in place
+    json::JSON const shared = json::JSON::load("[1.5, 2.5, 3.5]");
+    auto view = shared.as_doubles();
+    json::JSON const reader = shared;
+    REQUIRE(reader.at(2).to_float() == 3.5);
+    REQUIRE(&reader.at(0) == &shared.at(0));
+    REQUIRE(shared.as_doubles().data() == view.data());
+    REQUIRE(view[2] == 3.5);
+    REQUIRE(reader.array_range().begin()->to_float() == 1.5);
+    REQUIRE(shared.as_doubles().empty());
+
+    // copies read concurrently, each building or finding the nodes
+    json::JSON const counts = json::JSON::load("[1, 2, 3, 4]");
+    std::atomic<long> total{ 0 };
+    std::vector<std::thread> threads{};
+    for (int i = 0; i < 4; ++i)
+        threads.emplace_back([copy = counts, &total] {
+            long partial = 0;
+            for (unsigned j = 0; j < copy.length(); ++j)
+                partial += copy.at(j).to_int() + copy.as_integers()[j];
+            total += partial;
+        });
+    for (auto& thread : threads)
+        thread.join();
+    REQUIRE(total == 80);
+
+    // writing through a node boxes the array, and copies follow
+    json::JSON copy = integers;
+    REQUIRE(copy[1].to_int() == -2);
+    copy[0] = 10;
+    REQUIRE(copy.as_integers().empty());
+    REQUIRE(integers.as_integers().empty());
+    REQUIRE(integers[0].to_int() == 10);
+    integers.append(4);
+    REQUIRE(copy.length() == 4);
+
+    // boxed arrays nested in containers are torn down with them
+    {
+        json::JSON nested = json::JSON::load(R"({"data":{"values":[1,2]}})");
+        nested["data"]["values"][0] = 10;
+        REQUIRE(nested["data"]["values"] == json::array(10, 2));
+        json::JSON const outer = json::JSON::load(R"({"b":{"a":[3,4]}})");
+        long elements = 0;
+        for (auto& value : outer.at("b").at("a").array_range())
+            elements += value.to_int();
+        REQUIRE(elements == 7);
+    }
+
+    // errors are reported as for boxed arrays
+    auto comma = json::JSON::try_load("[1, 2 3]");
+    REQUIRE(comma.error.code == Code::expected_comma);
+    REQUIRE(comma.error.offset == 6);
+    REQUIRE(comma.error.pointer == "/2");
+    REQUIRE(json::JSON::try_load("[1, 2,]").error.pointer == "/2");
+    REQUIRE(json::JSON::try_load("[1, -]").error.code == Code::invalid_number);
+}
+
+TEST_CASE("JSON::load padded input")
+{
+    using Code = json::Parse_Error::Code;
+    // views are read up to their size, never to the next NUL
+    std::string text = R"(12345 "abc" [1, 2])";
+    REQUIRE(json::JSON::load(std::string_view(text.data(), 3)).to_int() ==
+            123);
+    auto open = json::JSON::try_load(std::string_view(text.data() + 6, 4));
+    REQUIRE(open.error.code == Code::unterminated_string);
+    auto cut = json::JSON::try_load(std::string_view(text.data() + 12, 5));
+    REQUIRE(cut.error.code == Code::unexpected_end);
+    REQUIRE(cut.error.offset == 5);
+    REQUIRE(json::JSON::try_load(std::string_view("nul", 3)).error.code ==
+            Code::invalid_literal);
+
+    // padded buffers are parsed in place, strings scanned in whole blocks
+    std::string body(100, 'x');
+    json::Padded_String padded("[\"" + body + "\", true]");
+    REQUIRE(padded.size() == body.size() + 10);
+    REQUIRE(padded.data()[padded.size()] == '\0');
+    auto value = json::JSON::load(padded);
+    REQUIRE(value[0].to_string() == body);
+    REQUIRE(value[1].to_bool());
+    json::Parse_Error error{};
+    REQUIRE(json::JSON::load(json::Padded_String("\"" + body), error)
+                .is_null());
+    REQUIRE(error.code == Code::unterminated_string);
+    REQUIRE(json::JSON::load(json::Padded_String{}, error).is_null());
+    REQUIRE(error.code == Code::unexpected_end);
+}
+
+TEST_CASE("json::Resource_Scope")
+{
+    struct Counting : std::pmr::memory_resource
+    {
+        size_t allocations = 0;
+        size_t outstanding = 0;
+
+        void* do_allocate(size_t bytes, size_t align) override
+        {
+            ++allocations;
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, size_t bytes, size_t align) override
+        {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(
+            std::pmr::memory_resource const& other) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+    Counting counting{};
+    json::Options options{};
+    options.resource = &counting;
+    {
+        auto value = json::JSON::load(
+            R"({"a": [1, {"b": "a string too long for small buffers"}]})",
+            options);
+        REQUIRE(value.resource() == &counting);
+        REQUIRE(value["a"].resource() == &counting);
+        REQUIRE(value["a"][1].resource() == &counting);
+        REQUIRE(value["a"][1]["b"].resource() == nullptr);
+        REQUIRE(counting.allocations >= 5);
+
+        // members added later come from the container's resource
+        size_t before = counting.allocations;
+        value["c"] = 1;
+        REQUIRE(counting.allocations > before);
+
+        // and so do long keys and string buffers
+        std::string key(100, 'k');
+        std::string text(200, 't');
+        size_t held = counting.outstanding;
+        auto named = json::JSON::load(
+            "{\"" + key + "\": \"" + text + "\"}", options);
+        REQUIRE(counting.outstanding - held >= key.size() + text.size());
+        auto const& member = *named.object_range().begin();
+        REQUIRE(member.first == std::string_view(key));
+        REQUIRE(json::detail::user_resource(
+                    member.first.get_allocator().resource()) == &counting);
+        REQUIRE(member.second.text() == text);
+    }
+    REQUIRE(counting.outstanding == 0);
+    REQUIRE(json::JSON::load("[1]").resource() ==
+            std::pmr::get_default_resource());
+
+    // documents built by hand, in a fixed buffer that must not overflow
+    alignas(std::max_align_t) char buffer[4096];
+    std::pmr::monotonic_buffer_resource arena(
+        buffer, sizeof(buffer), std::pmr::null_memory_resource());
+    {
+        json::Resource_Scope scope(&arena);
+        auto object = json::object();
+        object["list"] = json::array(1, 2, 3);
+        object["name"] = "arena";
+        REQUIRE(object["list"].resource() == &arena);
+        REQUIRE(object.dump() ==
+                json::JSON::load(R"({"list": [1, 2, 3], "name": "arena"})")
+                    .dump());
+        REQUIRE(json::from_msgpack(json::to_msgpack(object)).resource() ==
+                &arena);
+    }
+    REQUIRE(json::object().resource() == std::pmr::get_default_resource());
+}
+
+TEST_CASE("json::to_msgpack and json::to_cbor")
+{
+    using Bytes = std::vector<uint8_t>;
+    const std::string input = R"({
+        "id" : 7,
+        "neg" : -300,
+        "ratio" : 0.1,
+        "half" : 1.5,
+        "tags" : [ "a\"b", true, false, null ],
+        "ke\"y" : { "nested" : [] }
+    })";
+    auto document = json::JSON::load(input);
+
+    for (bool cbor : { false, true }) {
+        Bytes bytes =
+            cbor ? json::to_cbor(document) : json::to_msgpack(document);
+        json::JSON decoded =
+            cbor ? json::from_cbor(bytes) : json::from_msgpack(bytes);
+        REQUIRE(decoded == document);
+        REQUIRE(decoded["id"].JSON_type() == json::JSON::Class::Integral);
+        REQUIRE(decoded["half"].JSON_type() == json::JSON::Class::Floating);
+        REQUIRE(decoded["ratio"].to_float() == 0.1);
+        REQUIRE(bytes.size() < document.dump(0, "").size() / 2);
+
+        // every strict prefix is rejected
+        for (size_t size = 0; size < bytes.size(); ++size)
+            REQUIRE((cbor ? json::from_cbor(bytes.data(), size)
+                          : json::from_msgpack(bytes.data(), size))
+                        .is_null());
+    }
+
+    // encodings from the MessagePack spec and RFC 8949 appendix A
+    REQUIRE(json::to_msgpack(json::JSON(300)) == Bytes{ 0xcd, 0x01, 0x2c });
+    REQUIRE(json::to_msgpack(json::JSON(-33)) == Bytes{ 0xd0, 0xdf });
+    REQUIRE(json::to_msgpack(json::JSON("hi")) == Bytes{ 0xa2, 'h', 'i' });
+    REQUIRE(json::to_cbor(json::JSON(1000000)) ==
+            Bytes{ 0x1a, 0x00, 0x0f, 0x42, 0x40 });
+    REQUIRE(json::to_cbor(json::JSON(-1000)) == Bytes{ 0x39, 0x03, 0xe7 });
+    REQUIRE(json::to_cbor(json::JSON(1.1)) ==
+            Bytes{ 0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a });
+    REQUIRE(json::to_cbor(json::JSON::load("[1, [2, 3]]")) ==
+            Bytes{ 0x82, 0x01, 0x82, 0x02, 0x03 });
+
+    // indefinite lengths, half floats and tags
+    REQUIRE(json::from_cbor(Bytes{ 0xbf, 0x61, 'a', 0x9f, 0x01, 0xff,
+                                   0x61, 'b', 0x7f, 0x61, 'x', 0x61,
+                                   'y',  0xff, 0xff }) ==
+            json::JSON::load(R"({"a" : [1], "b" : "xy"})"));
+    REQUIRE(json::from_cbor(Bytes{ 0xf9, 0x3e, 0x00 }).to_float() == 1.5);
+    REQUIRE(json::from_cbor(Bytes{ 0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0 })
+                .to_int() == 1363896240);
+
+    // unsigned integers beyond a long survive as text
+    json::Options options{};
+    options.lazy_numbers = true;
+    auto big = json::JSON::load("[18446744073709551615]", options);
+    REQUIRE(json::from_msgpack(json::to_msgpack(big))[0].to_uint() ==
+            18446744073709551615UL);
+    REQUIRE(json::from_cbor(json::to_cbor(big))[0].to_uint() ==
+            18446744073709551615UL);
+
+    // writers stream containers of unknown size
+    json::Msgpack_Writer writer;
+    json::write(std::vector<std::string>{ "x", "y" }, writer);
+    REQUIRE(json::from_msgpack(writer.bytes()) ==
+            json::JSON::load(R"(["x", "y"])"));
+
+    REQUIRE(json::from_msgpack(Bytes{ 0x91, 0x01, 0x02 }).is_null());
+    REQUIRE(json::from_cbor(Bytes{ 0x9b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                                   0xff, 0xff })
+                .is_null());
+
+    using Code = json::Parse_Error::Code;
+    json::Parse_Error error{};
+    REQUIRE(json::from_msgpack(Bytes{ 0x91, 0x01, 0x02 }, error).is_null());
+    REQUIRE(error.code == Code::trailing_content);
+    REQUIRE(error.offset == 2);
+    REQUIRE(json::from_cbor(Bytes{ 0x82, 0x01 }, error).is_null());
+    REQUIRE(error.code == Code::unexpected_end);
+    REQUIRE(json::from_cbor(Bytes{ 0xa1, 0x01, 0x02 }, error).is_null());
+    REQUIRE(error.code == Code::expected_key);
+    REQUIRE(json::from_cbor(Bytes{ 0x81, 0x01 }, error).size() == 1);
+    REQUIRE(!error);
+}
+
+TEST_CASE("json::Stats")
+{
+    json::Stats::reset();
+    auto value = json::JSON::load(R"({"a": [1, 2.5, "x\ty"], "b": null})");
+    auto text = value.dump();
+    auto local = json::Stats::local();
+    auto stats = json::Stats::snapshot().to_json();
+    REQUIRE(stats["enabled"].to_bool() == json::Stats::enabled);
+    if constexpr (json::Stats::enabled) {
+        REQUIRE(local.loads == 1);
+        REQUIRE(local.dumps == 1);
+        REQUIRE(local.bytes_written == text.size());
+        REQUIRE(local.max_depth == 2);
+        REQUIRE(local.strings == 3);
+        REQUIRE(local.escapes == 1);
+        REQUIRE(stats["nodes"]["integral"].to_int() == 1);
+        REQUIRE(stats["nodes"]["object"].to_int() == 1);
+        REQUIRE(stats["allocations"].to_int() > 0);
+
+        // counters of exited threads stay in the totals
+        std::thread([] { json::JSON::load("[true]"); }).join();
+        REQUIRE(json::Stats::snapshot().loads == 2);
+
+        // allocations are counted at the document's resource
+        struct Tally : std::pmr::memory_resource
+        {
+            size_t allocations = 0;
+            size_t bytes = 0;
+
+            void* do_allocate(size_t size, size_t align) override
+            {
+                ++allocations;
+                bytes += size;
+                return std::pmr::new_delete_resource()->allocate(size, align);
+            }
+            void do_deallocate(void* p, size_t size, size_t align) override
+            {
+                std::pmr::new_delete_resource()->deallocate(p, size, align);
+            }
+            bool do_is_equal(
+                std::pmr::memory_resource const& other) const noexcept override
+            {
+                return this == &other;
+            }
+        };
+        Tally tally{};
+        json::Options options{};
+        options.resource = &tally;
+        auto before = json::Stats::local();
+        auto counted = json::JSON::load(
+            R"({"k": ["a string too long for small buffers", {}]})", options);
+        auto after = json::Stats::local();
+        REQUIRE(tally.allocations > 0);
+        REQUIRE(after.allocations - before.allocations == tally.allocations);
+        REQUIRE(after.bytes_allocated - before.bytes_allocated == tally.bytes);
+        REQUIRE(counted.resource() == &tally);
+
+        // writes after the load are not counted
+        counted["more"] = "another string too long for small buffers";
+        REQUIRE(tally.allocations > after.allocations - before.allocations);
+        REQUIRE(json::Stats::local().allocations == after.allocations);
+    } else {
+        REQUIRE(local.loads == 0);
+        REQUIRE(stats["bytes_read"].to_int() == 0);
+    }
+    json::Stats::reset();
+    REQUIRE(json::Stats::snapshot().loads == 0);
+}
+
+TEST_CASE("json::Trace_Sink")
+{
+    struct Recorder : json::Trace_Sink
+    {
+        std::vector<json::Trace_Event> events{};
+        void event(json::Trace_Event const& event) noexcept override
+        {
+            events.push_back(event);
+        }
+    };
+    Recorder recorder{};
+    recorder.subtree_bytes = 8;
+    REQUIRE(json::set_trace_sink(&recorder) == nullptr);
+    auto value = json::JSON::load(R"({"a": [1, 2, 3, 4], "b": [5]})");
+    auto text = value.dump();
+    REQUIRE(json::set_trace_sink(nullptr) == &recorder);
+    json::JSON::load("[]");
+
+    std::string phases{};
+    for (auto const& event : recorder.events)
+        phases += std::string(event.name) + event.phase + " ";
+    if constexpr (json::detail::trace_enabled) {
+        // only the array of four and the root span eight bytes or more
+        REQUIRE(phases == "parseB subtreeX subtreeX parseE dumpB dumpE ");
+        REQUIRE(recorder.events[1].bytes == 12);
+        REQUIRE(recorder.events[3].bytes == 29);
+        REQUIRE(recorder.events[5].bytes == text.size());
+    } else {
+        REQUIRE(phases.empty());
+    }
+
+    auto path = std::filesystem::temp_directory_path() / "simplejson.trace";
+    {
+        json::Chrome_Trace_Writer writer(path.string());
+        REQUIRE(writer.is_open());
+        json::set_trace_sink(&writer);
+        json::JSON::load(text);
+    }
+    REQUIRE_FALSE(json::Chrome_Trace_Writer("no/such/dir/x.trace").is_open());
+    auto trace = json::JSON::load_file(path.string());
+    std::filesystem::remove(path);
+    REQUIRE(trace.JSON_type() == json::JSON::Class::Array);
+    if constexpr (json::detail::trace_enabled) {
+        REQUIRE(trace.length() == 2);
+        REQUIRE(trace[0]["ph"].to_string() == "B");
+        REQUIRE(trace[1]["args"]["bytes"].to_int() ==
+                static_cast<long>(text.size()));
+    }
+}
+
+#if __cplusplus >= 202002L
+TEST_CASE("json::literals::operator\"\"_json")
+{
+    using namespace json::literals;
+    static constexpr auto config = R"({
+        "retries" : 3,
+        "name" : "caf\u00e9 \ud83d\ude00",
+        "rate" : 1.25,
+        "hosts" : [ "a", [ 2, 3 ], { "tls" : true } ],
+        "timeout" : 1.5E+2,
+        "proxy" : null
+    })"_json;
+
+    static_assert(config.size() == 6);
+    static_assert(config["retries"].to_int() == 3);
+    static_assert(config["rate"].to_float() == 1.25);
+    static_assert(config["timeout"].to_float() == 150.0);
+    static_assert(config["hosts"][1][1].to_int() == 3);
+    static_assert(config["hosts"][2]["tls"].to_bool());
+    static_assert(config["proxy"].JSON_type() == json::JSON::Class::Null);
+    static_assert(config["missing"].is_null());
+    static_assert(!config.root().has_key("missing"));
+    static_assert("[]"_json.size() == 0);
+
+    // converted as exactly as the runtime parser
+    static constexpr auto numbers =
+        "[1e300, 2.2250738585072014e-308, 4.9e-324, 0.1, 1e400]"_json;
+    static_assert(numbers[0].to_float() == 1e300);
+    static_assert(numbers[1].to_float() == 2.2250738585072014e-308);
+    static_assert(numbers[2].to_float() == 4.9e-324);
+    static_assert(numbers[3].to_float() == 0.1);
+    static_assert("[-9223372036854775808]"_json[0].to_int() == LONG_MIN);
+    REQUIRE(numbers.to_json() ==
+            json::JSON::load(
+                "[1e300, 2.2250738585072014e-308, 4.9e-324, 0.1, 1e400]"));
+
+    REQUIRE(config["name"].to_string() == "caf\xc3\xa9 \xf0\x9f\x98\x80");
+
+    size_t count = 0;
+    for (auto host : config["hosts"]) {
+        REQUIRE(host.key().empty());
+        ++count;
+    }
+    REQUIRE(count == 3);
+
+    REQUIRE(config.to_json() == json::JSON::load(R"({
+        "retries" : 3,
+        "name" : "caf\u00e9 \ud83d\ude00",
+        "rate" : 1.25,
+        "hosts" : [ "a", [ 2, 3 ], { "tls" : true } ],
+        "timeout" : 1.5E+2,
+        "proxy" : null
+    })"));
+}
+#endif